@@ -25,11 +25,15 @@
 #include "Player.hpp"
 
 #include "PlayerMoveEvent.hpp"
+#include "PlayerMovedEvent.hpp"
+#include "PlayerBulkMoveEvent.hpp"
 #include "PlayerChatEvent.hpp"
+#include "WorkerPool.hpp"
 
 #include <cstdio>
 #include <string>
 #include <cstdlib>
+#include <stdexcept>
 
 
 
@@ -38,7 +42,7 @@
  *
  * This snippet shows how to implement multiple EventHandlers in a single class
  */
-class PlayerListener : public EventHandler<PlayerMoveEvent>, public EventHandler<PlayerChatEvent>
+class PlayerListener : public EventHandler<PlayerMoveEvent>, public EventHandler<PlayerBulkMoveEvent>, public EventHandler<PlayerChatEvent>
 {
 public:
 	PlayerListener() { }
@@ -60,8 +64,8 @@ public:
 
 		Player & p = e.getPlayer();
 
-		// Cancel the event if the new player position is outside of the border area
-		if (std::abs(p.getX()) > BORDER_SIZE || std::abs(p.getZ()) > BORDER_SIZE) {
+		// Cancel the event if the proposed player position is outside of the border area
+		if (std::abs(e.getNewX()) > BORDER_SIZE || std::abs(e.getNewZ()) > BORDER_SIZE) {
 			e.setCanceled(true);
 			printf("Canceled setting player %s position - outside of border\n", p.getName().c_str());
 			return;
@@ -69,6 +73,25 @@ public:
 	}
 
 
+	/**
+	 * \brief Same border check as above, for a whole batch of player moves at once
+	 *
+	 * The bulk event checks all the moves with vector instructions and cancels the ones outside
+	 * of the border in its cancel mask
+	 *
+	 * @param e The PlayerBulkMoveEvent event
+	 */
+	virtual void onEvent(PlayerBulkMoveEvent & e) override {
+
+		// Ignore the event if it's already been canceled
+		if (e.getCanceled()) {
+			return;
+		}
+
+		e.cancelOutside(BORDER_SIZE);
+	}
+
+
 	/**
 	 * This event handler prints out a debug message whenever a chat event is fired
 	 *
@@ -90,6 +113,52 @@ private:
 };
 
 
+/**
+ * \brief Cancels player moves outside of the border area without printing anything
+ */
+class BorderGuard : public EventHandler<PlayerMoveEvent>
+{
+public:
+	virtual void onEvent(PlayerMoveEvent & e) override {
+		if (std::abs(e.getNewX()) > BORDER_SIZE || std::abs(e.getNewZ()) > BORDER_SIZE) {
+			e.setCanceled(true);
+		}
+	}
+
+private:
+	static const int BORDER_SIZE = 500;
+
+};
+
+
+/**
+ * \brief Counts the player moves that haven't been canceled
+ */
+class MoveCounter : public EventHandler<PlayerMoveEvent>
+{
+public:
+	MoveCounter() : moves(0) { }
+
+	virtual void onEvent(PlayerMoveEvent & e) override {
+
+		// Ignore the event if it's already been canceled
+		if (e.getCanceled()) {
+			return;
+		}
+
+		moves++;
+	}
+
+	int getMoves() const {
+		return moves;
+	}
+
+private:
+	int moves;
+
+};
+
+
 
 /**
  * \brief Demo class showing off some functionality of the EventBus
@@ -201,28 +270,105 @@ public:
 		delete playerChatReg;
 	}
 
+
+	/**
+	 * Demo Function 2
+	 *
+	 * Moves a batch of players with a single bulk event instead of one event per player
+	 */
+	void Demo2() {
+
+		Player player1("Player1");
+		Player player2("Player2");
+		Player player3("Player3");
+
+		PlayerListener playerListener;
+		HandlerRegistration* bulkMoveReg = EventBus::AddHandler<PlayerBulkMoveEvent>(playerListener);
+
+		// Collect the moves for this tick into one event. Player 2 tries to leave the border area
+		PlayerBulkMoveEvent e(*this, 3);
+		e.add(player1, 100, 0, 100);
+		e.add(player2, 800, 0, 0);
+		e.add(player3, -200, 0, 450);
+
+		EventBus::FireEvent(e);
+
+		// Only the moves that weren't canceled by a handler are applied
+		printf("Moved %d of %d players\n", static_cast<int>(e.apply()), static_cast<int>(e.size()));
+
+		for (std::size_t i = 0; i < e.size(); i++) {
+			if (e.isCanceled(i)) {
+				printf("Canceled moving player %s - outside of border\n", e.getPlayer(i).getName().c_str());
+			}
+		}
+
+		bulkMoveReg->removeHandler();
+		delete bulkMoveReg;
+	}
+
+
+	/**
+	 * Demo Function 3
+	 *
+	 * Fires the same player moves with and without workers to check that parallel dispatch gives
+	 * the same result as calling the handlers one after another
+	 */
+	void Demo3() {
+		const int serial = countAcceptedMoves(nullptr, 0);
+
+		WorkerPool workers(4);
+		const int parallel = countAcceptedMoves(&workers, static_cast<unsigned int>(workers.size()));
+
+		printf("Accepted %d of %d moves serially and %d in parallel\n", serial, MOVE_COUNT, parallel);
+
+		if (serial != parallel) {
+			throw std::runtime_error("parallel dispatch didn't match serial dispatch");
+		}
+	}
+
 private:
+	static const int MOVE_COUNT = 200;
+
 	HandlerRegistration* playerMoveReg;
 	HandlerRegistration* playerChatReg;
 
 
-	bool setPlayerPostionWithEvent(Player & player, int x, int y, int z) {
-
-		int savedX = player.getX();
-		int savedY = player.getY();
-		int savedZ = player.getZ();
+	int countAcceptedMoves(Executor * const workers, unsigned int count) {
+		EventBus bus;
+		bus.setWorkers(workers, count);
 
-		player.setPosition(x, y, z);
+		Player player("Player1");
+		BorderGuard guard;
+		MoveCounter tracker;
+		MoveCounter logger;
 
-		PlayerMoveEvent e(player, player, savedX, savedY, savedZ);
-		EventBus::FireEvent(e);
+		// The guard cancels moves, and the counters skip canceled moves just like PlayerListener does
+		HandlerRegistration* guardReg = bus.addHandler<PlayerMoveEvent>(guard, HandlerOptions().cancels());
+		HandlerRegistration* trackerReg = bus.addHandler<PlayerMoveEvent>(tracker, HandlerOptions().reads("player positions"));
+		HandlerRegistration* loggerReg = bus.addHandler<PlayerMoveEvent>(logger, HandlerOptions().writes("move log"));
 
-		if (e.getCanceled()) {
-			player.setPosition(savedX, savedY, savedZ);
-			return false;
+		for (int x = 0; x < MOVE_COUNT; x++) {
+			PlayerMoveEvent e(*this, player, 0, 0, 0, x * 10, 0, 0);
+			bus.fireEvent(e);
 		}
 
-		return true;
+		delete guardReg;
+		delete trackerReg;
+		delete loggerReg;
+
+		return tracker.getMoves() == logger.getMoves() ? tracker.getMoves() : -1;
+	}
+
+
+	bool setPlayerPostionWithEvent(Player & player, int x, int y, int z) {
+
+		// The PlayerMoveEvent proposes the new position before anything changes. The player is only
+		// moved if no handler cancels it, after which a PlayerMovedEvent is fired to any observers
+		PlayerMoveEvent e(player, player, player.getX(), player.getY(), player.getZ(), x, y, z);
+
+		return EventBus::FireTwoPhase<PlayerMovedEvent>(e, [&player](PlayerMoveEvent & accepted) {
+			player.setPosition(accepted.getNewX(), accepted.getNewY(), accepted.getNewZ());
+		});
 	}
 
 };
@@ -236,10 +382,13 @@ int main()
 	{
 		EventBusDemo demo;
 		demo.Demo1();
+		demo.Demo2();
+		demo.Demo3();
 	}
 	catch (std::runtime_error & e)
 	{
 		printf("Runtime exception: %s\n", e.what());
+		return 1;
 	}
 }
 
@@ -24,6 +24,8 @@
 #define _SRC_PLAYER_HPP_
 
 #include "Object.hpp"
+#include "SharedString.hpp"
+#include "StringTable.hpp"
 //#include "PlayerMoveEvent.hpp"
 
 #include <string>
@@ -39,7 +41,7 @@ class Player : public Object
 {
 public:
 	Player(std::string name) :
-		name(name),
+		name(StringTable::GetInstance()->intern(name)),
 		posX(0),
 		posY(0),
 		posZ(0)
@@ -49,7 +51,7 @@ public:
 
 	}
 
-	const std::string & getName() {
+	const SharedString & getName() {
 		return name;
 	}
 
@@ -72,7 +74,7 @@ public:
 	}
 
 private:
-	std::string name;
+	SharedString name;
 	int posX;
 	int posY;
 	int posZ;
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_CYCLE_CLOCK_HPP_
+#define _SRC_EVENT_CYCLE_CLOCK_HPP_
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define EVENTBUS_HAS_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define EVENTBUS_HAS_RDTSC 1
+#endif
+
+/**
+ * \brief Low overhead clock for timing event handlers
+ *
+ * Reads the CPU time stamp counter where it is available and falls back to the steady clock
+ * elsewhere. The tick rate is calibrated against the steady clock the first time it's needed.
+ */
+class CycleClock {
+public:
+	/**
+	 * \brief Reads the current tick count
+	 *
+	 * @return The tick count
+	 */
+	static std::uint64_t Now() {
+#if defined(EVENTBUS_HAS_RDTSC)
+		return __rdtsc();
+#else
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+	}
+
+
+	/**
+	 * \brief Converts a duration to ticks
+	 *
+	 * @param duration The duration to convert
+	 * @return The number of ticks
+	 */
+	static std::uint64_t ToTicks(std::chrono::nanoseconds duration) {
+		return static_cast<std::uint64_t>(duration.count() * TicksPerNanosecond());
+	}
+
+
+	/**
+	 * \brief Converts ticks to a duration
+	 *
+	 * @param ticks The number of ticks
+	 * @return The duration
+	 */
+	static std::chrono::nanoseconds ToDuration(std::uint64_t ticks) {
+		return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(ticks / TicksPerNanosecond()));
+	}
+
+private:
+	static double TicksPerNanosecond() {
+		static const double rate = Calibrate();
+		return rate;
+	}
+
+
+	static double Calibrate() {
+#if defined(EVENTBUS_HAS_RDTSC)
+		// Spin for a couple of milliseconds and compare the counter with the steady clock
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		const std::uint64_t startTicks = Now();
+		std::chrono::steady_clock::time_point end;
+
+		do {
+			end = std::chrono::steady_clock::now();
+		} while (end - start < std::chrono::milliseconds(2));
+
+		const std::uint64_t ticks = Now() - startTicks;
+		const double nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+		return ticks > 0 ? ticks / nanoseconds : 1.0;
+#else
+		return 1.0;
+#endif
+	}
+};
+
+#endif /* _SRC_EVENT_CYCLE_CLOCK_HPP_ */
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_DELIVERY_FILTER_HPP_
+#define _SRC_EVENT_DELIVERY_FILTER_HPP_
+
+#include "Object.hpp"
+#include "HandlerOptions.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+
+/**
+ * \brief Sampling and rate limit state of a single handler registration
+ *
+ * The filter is stored inline in the registration so checking it doesn't touch any other memory,
+ * except for per-sender rate limits which keep a bucket for every sender in a separate map.
+ */
+class DeliveryFilter {
+public:
+	/**
+	 * \brief Creates a filter that accepts every event
+	 */
+	DeliveryFilter() :
+		sampleEvery(1),
+		sampleCount(0),
+		rate(0),
+		burst(0),
+		perSender(false),
+		pruneAt(MinPruneSize)
+	{ }
+
+
+	/**
+	 * \brief Takes the sampling and rate limit settings from registration options
+	 *
+	 * @param options The registration options
+	 */
+	void configure(const HandlerOptions & options) {
+		sampleEvery = options.getSampleEvery() > 0 ? options.getSampleEvery() : 1;
+		sampleCount = 0;
+		rate = options.getRateLimit();
+		burst = options.getRateBurst() >= 1 ? options.getRateBurst() : 1;
+		perSender = options.getRatePerSender();
+
+		bucket.tokens = burst;
+		bucket.last = std::chrono::steady_clock::now();
+		senderBuckets.reset();
+		pruneAt = MinPruneSize;
+	}
+
+
+	/**
+	 * \brief Gets whether the filter can reject events
+	 *
+	 * @return true if sampling or a rate limit is configured
+	 */
+	bool isActive() const {
+		return sampleEvery > 1 || rate > 0;
+	}
+
+
+	/**
+	 * \brief Decides whether an event is delivered to the handler
+	 *
+	 * Sampling is applied first, so only sampled events use up rate limit tokens.
+	 *
+	 * @param sender The sender of the event
+	 * @return true if the event should be delivered
+	 */
+	bool accept(Object & sender) {
+		if (sampleEvery > 1) {
+			if (++sampleCount < sampleEvery) {
+				return false;
+			}
+
+			sampleCount = 0;
+		}
+
+		if (rate <= 0) {
+			return true;
+		}
+
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		if (!perSender) {
+			return bucket.take(now, rate, burst);
+		}
+
+		if (!senderBuckets) {
+			senderBuckets.reset(new BucketMap());
+		}
+
+		BucketMap::iterator it = senderBuckets->find(&sender);
+
+		if (it == senderBuckets->end()) {
+			if (senderBuckets->size() >= pruneAt) {
+				prune(now);
+			}
+
+			Bucket fresh;
+			fresh.tokens = burst;
+			fresh.last = now;
+			it = senderBuckets->insert(BucketMap::value_type(&sender, fresh)).first;
+		}
+
+		return it->second.take(now, rate, burst);
+	}
+
+
+	/**
+	 * \brief Drops the rate limit bucket of a sender
+	 *
+	 * A sender that is destroyed leaves its bucket behind, and a new sender at the same address
+	 * would inherit it, so this should be called before a sender is destroyed.
+	 *
+	 * @param sender The sender object
+	 */
+	void forget(Object & sender) {
+		if (senderBuckets) {
+			senderBuckets->erase(&sender);
+		}
+	}
+
+
+private:
+	/**
+	 * \brief Token bucket refilled at the configured rate up to the burst size
+	 */
+	struct Bucket {
+		double tokens;
+		std::chrono::steady_clock::time_point last;
+
+		bool take(std::chrono::steady_clock::time_point now, double rate, double burst) {
+			tokens += std::chrono::duration<double>(now - last).count() * rate;
+			last = now;
+
+			if (tokens > burst) {
+				tokens = burst;
+			}
+
+			if (tokens < 1) {
+				return false;
+			}
+
+			tokens -= 1;
+			return true;
+		}
+	};
+
+	typedef std::unordered_map<Object*, Bucket> BucketMap;
+
+	static const std::size_t MinPruneSize = 64;
+
+	unsigned int sampleEvery;
+	unsigned int sampleCount;
+
+	double rate;
+	double burst;
+	bool perSender;
+
+	Bucket bucket;
+	std::unique_ptr<BucketMap> senderBuckets;
+
+	// Size of the bucket map that triggers the next prune
+	std::size_t pruneAt;
+
+
+	/**
+	 * \brief Drops the buckets that have refilled to the burst size
+	 *
+	 * A full bucket behaves exactly like a new one, so senders that went quiet are forgotten. The
+	 * next prune waits until the map has doubled, which keeps the cost per event constant.
+	 *
+	 * @param now The current time
+	 */
+	void prune(std::chrono::steady_clock::time_point now) {
+		for (BucketMap::iterator it = senderBuckets->begin(); it != senderBuckets->end(); ) {
+			const double tokens = it->second.tokens + std::chrono::duration<double>(now - it->second.last).count() * rate;
+
+			if (tokens >= burst) {
+				it = senderBuckets->erase(it);
+			} else {
+				++it;
+			}
+		}
+
+		pruneAt = senderBuckets->size() * 2 > MinPruneSize ? senderBuckets->size() * 2 : MinPruneSize;
+	}
+};
+
+#endif /* _SRC_EVENT_DELIVERY_FILTER_HPP_ */
@@ -0,0 +1,493 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_EVENT_AWAITER_HPP_
+#define _SRC_EVENT_EVENT_AWAITER_HPP_
+
+#include "Object.hpp"
+#include "EventBus.hpp"
+#include "EventHandler.hpp"
+#include "Executor.hpp"
+#include "OverflowPolicy.hpp"
+
+// Coroutine support needs a C++20 compiler, the rest of the EventBus stays C++11
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+
+
+/**
+ * \brief Awaitable that suspends a coroutine until the next event of type T is fired
+ *
+ * The awaiter is an EventHandler with an embedded registration, so it lives entirely in the
+ * coroutine frame and awaiting doesn't allocate. The registration is linked when the coroutine
+ * suspends and unlinked before it is resumed.
+ *
+ * Without an executor the coroutine is resumed inline from FireEvent and await_resume returns
+ * the fired event itself. With an executor the event is copied into the awaiter and the
+ * coroutine is resumed through Executor::post, so the returned reference is only valid for as
+ * long as the awaiter is alive. Only event types that can be copied can be awaited through an
+ * executor.
+ *
+ * \code
+ * PlayerChatEvent & chat = co_await NextEvent<PlayerChatEvent>(player);
+ * \endcode
+ */
+template <class T>
+class EventAwaiter : public EventHandler<T>
+{
+public:
+	/**
+	 * \brief Creates an awaiter for events from a specific sender
+	 *
+	 * @param bus The EventBus the event is fired on
+	 * @param sender The sender object to wait on, or nullptr for any sender
+	 * @param executor The executor used to resume the coroutine, or nullptr to resume inline
+	 */
+	EventAwaiter(EventBus & bus, Object * const sender, Executor * const executor) :
+		bus(bus),
+		registration(*this, sender),
+		executor(executor),
+		event(nullptr) {
+		if (executor != nullptr && !std::is_copy_constructible<T>::value) {
+			throw std::invalid_argument("EventAwaiter: events that can't be copied can't be awaited through an executor");
+		}
+	}
+
+
+	/**
+	 * \brief Empty virtual destructor, the registration unlinks itself
+	 */
+	virtual ~EventAwaiter() { }
+
+
+	bool await_ready() {
+		return false;
+	}
+
+
+	void await_suspend(std::coroutine_handle<> handle) {
+		continuation = handle;
+		bus.addRegistration(registration);
+	}
+
+
+	T & await_resume() {
+		return *event;
+	}
+
+
+	/**
+	 * \brief Receives the awaited event and resumes the coroutine
+	 *
+	 * @param e The fired event
+	 */
+	virtual void onEvent(T & e) override {
+		// Unlink first so the resumed coroutine is free to await the same event type again
+		registration.removeHandler();
+
+		if (executor == nullptr) {
+			event = &e;
+
+			// Nothing may touch this object after resuming, the coroutine may have destroyed it
+			continuation.resume();
+		} else {
+			keep(e, std::is_copy_constructible<T>());
+			executor->post(&Resume, continuation.address());
+		}
+	}
+
+private:
+	EventBus & bus;
+	EventBus::EventRegistration registration;
+	Executor* const executor;
+	std::coroutine_handle<> continuation;
+	std::optional<T> copy;
+	T* event;
+
+
+	/**
+	 * \brief Copies the event for the executor, only instantiated for event types that can be copied
+	 */
+	void keep(T & e, std::true_type) {
+		copy.emplace(e);
+		event = &*copy;
+	}
+
+	void keep(T &, std::false_type) {
+	}
+
+
+	static void Resume(void * address) {
+		std::coroutine_handle<>::from_address(address).resume();
+	}
+};
+
+
+/**
+ * \brief Async generator style subscription that yields every event of type T
+ *
+ * Unlike EventAwaiter the registration stays linked for the lifetime of the stream, so a
+ * coroutine looping over events doesn't relink a handler for every event. Events fired while
+ * the coroutine isn't waiting on the stream are copied into a queue and returned by the
+ * following calls to next, in the order they were fired. When the coroutine is waiting and
+ * there is no executor, it is resumed inline with the fired event itself.
+ *
+ * A coroutine that awaits something else between calls to next keeps the queue growing, so the
+ * queue is bounded. By default it holds 1024 events and drops the oldest one when it is full,
+ * setCapacity changes that.
+ *
+ * Event types that can't be copied can't be queued, so for those the events fired while the
+ * coroutine isn't waiting are skipped, and an executor can't be used.
+ *
+ * Like NextEvent, the constructors take the EventBus by pointer so it can't be mistaken for a
+ * sender.
+ *
+ * \code
+ * EventStream<PlayerMoveEvent> moves(player);
+ * for (;;) {
+ *     PlayerMoveEvent & e = co_await moves.next();
+ * }
+ * \endcode
+ */
+template <class T>
+class EventStream : public EventHandler<T>
+{
+public:
+	/**
+	 * \brief Awaitable returned by next()
+	 */
+	class Next {
+	public:
+		Next(EventStream & stream) :
+			stream(stream) {
+		}
+
+		bool await_ready() {
+			return false;
+		}
+
+		bool await_suspend(std::coroutine_handle<> handle) {
+			std::lock_guard<std::mutex> lock(stream.mutex);
+
+			// Don't suspend if an event was queued in the meantime
+			if (!stream.pending.empty()) {
+				return false;
+			}
+
+			stream.continuation = handle;
+			return true;
+		}
+
+		T & await_resume() {
+			return stream.take(std::is_copy_constructible<T>());
+		}
+
+	private:
+		EventStream & stream;
+	};
+
+
+	/**
+	 * \brief Creates a stream of events from any sender
+	 *
+	 * @param bus The EventBus the events are fired on
+	 * @param executor The executor used to resume the coroutine, or nullptr to resume inline
+	 */
+	EventStream(EventBus * const bus, Executor * const executor = nullptr) :
+		registration(*this, nullptr),
+		executor(executor),
+		capacity(DefaultCapacity),
+		policy(OverflowPolicy::DropOldest),
+		dropped(0),
+		event(nullptr) {
+		if (executor != nullptr && !std::is_copy_constructible<T>::value) {
+			throw std::invalid_argument("EventStream: events that can't be copied can't be streamed through an executor");
+		}
+
+		bus->addRegistration(registration);
+	}
+
+
+	/**
+	 * \brief Creates a stream of events from a specific sender
+	 *
+	 * @param bus The EventBus the events are fired on
+	 * @param sender The source sender object
+	 * @param executor The executor used to resume the coroutine, or nullptr to resume inline
+	 */
+	EventStream(EventBus * const bus, Object & sender, Executor * const executor = nullptr) :
+		registration(*this, &sender),
+		executor(executor),
+		capacity(DefaultCapacity),
+		policy(OverflowPolicy::DropOldest),
+		dropped(0),
+		event(nullptr) {
+		if (executor != nullptr && !std::is_copy_constructible<T>::value) {
+			throw std::invalid_argument("EventStream: events that can't be copied can't be streamed through an executor");
+		}
+
+		bus->addRegistration(registration);
+	}
+
+
+	/**
+	 * \brief Creates a stream of events from any sender on the current EventBus instance
+	 *
+	 * @param executor The executor used to resume the coroutine, or nullptr to resume inline
+	 */
+	EventStream(Executor * const executor = nullptr) :
+		EventStream(EventBus::GetInstance(), executor) {
+	}
+
+
+	/**
+	 * \brief Creates a stream of events from a specific sender on the current EventBus instance
+	 *
+	 * @param sender The source sender object
+	 * @param executor The executor used to resume the coroutine, or nullptr to resume inline
+	 */
+	EventStream(Object & sender, Executor * const executor = nullptr) :
+		EventStream(EventBus::GetInstance(), sender, executor) {
+	}
+
+
+	/**
+	 * \brief Empty virtual destructor, the registration unlinks itself
+	 */
+	virtual ~EventStream() { }
+
+
+	/**
+	 * \brief Returns an awaitable for the next event on the stream
+	 *
+	 * @return The awaitable
+	 */
+	Next next() {
+		return Next(*this);
+	}
+
+
+	/**
+	 * \brief Bounds the number of events queued while the coroutine isn't waiting
+	 *
+	 * Block can't be used, since the events are queued from FireEvent and only the coroutine can
+	 * make room. Conflate only looks for an event from the same sender once the queue is full.
+	 *
+	 * @param capacity The maximum number of queued events, or 0 for no limit
+	 * @param policy What to do with a new event when the queue is full
+	 */
+	void setCapacity(std::size_t capacity, OverflowPolicy policy = OverflowPolicy::DropOldest) {
+		if (policy == OverflowPolicy::Block) {
+			throw std::invalid_argument("EventStream: the Block policy can't be used, the coroutine is the only consumer");
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		this->capacity = capacity;
+		this->policy = policy;
+
+		while (capacity != 0 && pending.size() > capacity) {
+			pending.pop_front();
+			++dropped;
+		}
+	}
+
+
+	/**
+	 * \brief Gets the number of events discarded because the queue was full
+	 *
+	 * @return The number of discarded events
+	 */
+	unsigned long long getDropped() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return dropped;
+	}
+
+
+	/**
+	 * \brief Resumes the waiting coroutine, or queues the event if the coroutine isn't waiting
+	 *
+	 * @param e The fired event
+	 */
+	virtual void onEvent(T & e) override {
+		std::unique_lock<std::mutex> lock(mutex);
+		std::coroutine_handle<> handle = continuation;
+		continuation = nullptr;
+
+		if (handle && executor == nullptr) {
+			lock.unlock();
+			event = &e;
+			handle.resume();
+			return;
+		}
+
+		queue(e, std::is_copy_constructible<T>());
+		lock.unlock();
+
+		if (handle) {
+			executor->post(&Resume, handle.address());
+		}
+	}
+
+private:
+	static const std::size_t DefaultCapacity = 1024;
+
+	EventBus::EventRegistration registration;
+	Executor* const executor;
+
+	// The queue and the waiting coroutine are shared with the executor's thread
+	std::mutex mutex;
+	std::coroutine_handle<> continuation;
+	std::size_t capacity;
+	OverflowPolicy policy;
+	unsigned long long dropped;
+	std::deque<std::unique_ptr<T>> pending;
+	std::optional<T> current;
+	T* event;
+
+
+	/**
+	 * \brief Queues a copy of an event, only instantiated for event types that can be copied
+	 *
+	 * Events can have reference members and can't be assigned, so each queued event is held by
+	 * pointer and a conflated event is replaced by swapping the pointer. The mutex must be held.
+	 */
+	void queue(T & e, std::true_type) {
+		std::unique_ptr<T> copy(new T(e));
+
+		if (capacity != 0 && pending.size() >= capacity) {
+			++dropped;
+
+			if (policy == OverflowPolicy::DropNewest) {
+				return;
+			}
+
+			if (policy == OverflowPolicy::Conflate) {
+				for (auto & queued : pending) {
+					if (&queued->getSender() == &e.getSender()) {
+						queued = std::move(copy);
+						return;
+					}
+				}
+			}
+
+			pending.pop_front();
+		}
+
+		pending.push_back(std::move(copy));
+	}
+
+	void queue(T &, std::false_type) {
+	}
+
+
+	/**
+	 * \brief Gets the event the coroutine was resumed with, taking it from the queue if there is one
+	 */
+	T & take(std::true_type) {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (!pending.empty()) {
+			current.emplace(*pending.front());
+			pending.pop_front();
+			event = &*current;
+		}
+
+		return *event;
+	}
+
+	T & take(std::false_type) {
+		return *event;
+	}
+
+
+	static void Resume(void * address) {
+		std::coroutine_handle<>::from_address(address).resume();
+	}
+};
+
+
+/**
+ * \brief Waits for the next event of type T from any sender
+ *
+ * The bus is passed by pointer because an EventBus is an Object too. A reference would be
+ * indistinguishable from the overload that waits on a specific sender, which matters for events
+ * the bus fires itself, such as SlowHandlerEvent.
+ *
+ * @param bus The EventBus the event is fired on
+ * @param executor The executor used to resume the coroutine, or nullptr to resume inline
+ * @return The awaitable
+ */
+template <class T>
+EventAwaiter<T> NextEvent(EventBus * const bus, Executor * const executor = nullptr) {
+	return EventAwaiter<T>(*bus, nullptr, executor);
+}
+
+
+/**
+ * \brief Waits for the next event of type T from a specific sender
+ *
+ * @param bus The EventBus the event is fired on
+ * @param sender The source sender object
+ * @param executor The executor used to resume the coroutine, or nullptr to resume inline
+ * @return The awaitable
+ */
+template <class T>
+EventAwaiter<T> NextEvent(EventBus * const bus, Object & sender, Executor * const executor = nullptr) {
+	return EventAwaiter<T>(*bus, &sender, executor);
+}
+
+
+/**
+ * \brief Waits for the next event of type T from any sender on the current EventBus instance
+ *
+ * @param executor The executor used to resume the coroutine, or nullptr to resume inline
+ * @return The awaitable
+ */
+template <class T>
+EventAwaiter<T> NextEvent(Executor * const executor = nullptr) {
+	return EventAwaiter<T>(*EventBus::GetInstance(), nullptr, executor);
+}
+
+
+/**
+ * \brief Waits for the next event of type T from a specific sender on the current EventBus instance
+ *
+ * @param sender The source sender object
+ * @param executor The executor used to resume the coroutine, or nullptr to resume inline
+ * @return The awaitable
+ */
+template <class T>
+EventAwaiter<T> NextEvent(Object & sender, Executor * const executor = nullptr) {
+	return EventAwaiter<T>(*EventBus::GetInstance(), &sender, executor);
+}
+
+#endif /* __cpp_impl_coroutine */
+
+#endif /* _SRC_EVENT_EVENT_AWAITER_HPP_ */
@@ -25,3 +25,5 @@
 // Declare the static instance since this can't be done in the header file
 EventBus* EventBus::instance = nullptr;
 
+thread_local EventBus* EventBus::threadInstance = nullptr;
+
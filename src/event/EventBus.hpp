@@ -24,13 +24,30 @@
 #define _SRC_EVENT_EVENT_BUS_HPP_
 
 #include "Object.hpp"
+#include "CycleClock.hpp"
+#include "DeliveryFilter.hpp"
 #include "EventHandler.hpp"
 #include "Event.hpp"
+#include "Executor.hpp"
+#include "HandlerOptions.hpp"
 #include "HandlerRegistration.hpp"
+#include "ParallelSchedule.hpp"
+#include "ResourceAccess.hpp"
+#include "SlowHandlerEvent.hpp"
+#include "StickyEvents.hpp"
 
-#include <list>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <typeindex>
 #include <typeinfo>
 #include <unordered_map>
+#include <vector>
 
 
 /**
@@ -38,27 +55,61 @@
  *
  */
 class EventBus : public Object {
+private:
+	class Registrations;
+
 public:
+	class EventRegistration;
+
+
 	/**
-	 * \brief Default empty constructor
+	 * \brief Default constructor
 	 */
-	EventBus() { }
+	EventBus() :
+		sealed(false),
+		sealedDispatches(0),
+		sealedMultiplier(0),
+		sealedShift(0),
+		unsealedCount(0),
+		watchdogTicks(0),
+		watchdogStrikes(0),
+		watchdogExecutor(nullptr),
+		watchdogBacklog(0),
+		timings(nullptr),
+		reporting(false),
+		droppedDeliveries(0),
+		workers(nullptr),
+		workerCount(0),
+		wildcards(*this, typeid(Event))
+	{ }
 
 
 	/**
-	 * \brief Empty virtual destructor
+	 * \brief Virtual destructor
+	 *
+	 * Detaches any registrations that are still linked so they don't reference freed collections
 	 */
-	virtual ~EventBus() { }
+	virtual ~EventBus() {
+		for (auto & pair : handlers) {
+			delete pair.second;
+		}
+	}
 
 
 	/**
-	 * \brief Returns the EventBus singleton instance
+	 * \brief Returns the EventBus instance used by the static methods
 	 *
-	 * Creates a new instance of the EventBus if hasn't already been created
+	 * This is the bus bound to the calling thread with SetThreadInstance if there is one.
+	 * Otherwise it is the process-wide default instance, which is created if it hasn't already been
+	 * created.
 	 *
-	 * @return The singleton instance
+	 * @return The EventBus instance
 	 */
 	static EventBus* const GetInstance() {
+		if (threadInstance != nullptr) {
+			return threadInstance;
+		}
+
 		if (instance == nullptr) {
 			instance = new EventBus();
 		}
@@ -67,6 +118,216 @@ public:
 	}
 
 
+	/**
+	 * \brief Binds an EventBus to the calling thread
+	 *
+	 * While a bus is bound, the static methods called from this thread use it instead of the
+	 * default instance. This lets a thread-confined world keep its own small handler tables
+	 * without passing the bus around. The caller keeps ownership of the bus.
+	 *
+	 * @param bus The EventBus to bind, or nullptr to go back to the default instance
+	 */
+	static void SetThreadInstance(EventBus * const bus) {
+		threadInstance = bus;
+	}
+
+
+	/**
+	 * \brief Registers a new event handler with the current instance and a source specifier
+	 *
+	 * @param handler The event handler class
+	 * @param sender The source sender object
+	 * @param options Optional registration settings
+	 * @return An EventRegistration pointer which can be used to unregister the event handler
+	 */
+	template <class T>
+	static HandlerRegistration* const AddHandler(EventHandler<T> & handler, Object & sender, const HandlerOptions & options = HandlerOptions()) {
+		return GetInstance()->addHandler(handler, sender, options);
+	}
+
+
+	/**
+	 * \brief Registers a new event handler with the current instance and no source specified
+	 *
+	 * @param handler The event handler class
+	 * @param options Optional registration settings
+	 * @return An EventRegistration pointer which can be used to unregister the event handler
+	 */
+	template <class T>
+	static HandlerRegistration* const AddHandler(EventHandler<T> & handler, const HandlerOptions & options = HandlerOptions()) {
+		return GetInstance()->addHandler(handler, options);
+	}
+
+
+	/**
+	 * \brief Registers a handler for every event fired by a sender with the current instance
+	 *
+	 * @param handler The event handler class
+	 * @param sender The source sender object
+	 * @param options Optional registration settings
+	 * @return An EventRegistration pointer which can be used to unregister the event handler
+	 */
+	static HandlerRegistration* const AddWildcardHandler(EventHandler<Event> & handler, Object & sender, const HandlerOptions & options = HandlerOptions()) {
+		return GetInstance()->addWildcardHandler(handler, sender, options);
+	}
+
+
+	/**
+	 * \brief Registers a handler for every event with the current instance
+	 *
+	 * @param handler The event handler class
+	 * @param options Optional registration settings
+	 * @return An EventRegistration pointer which can be used to unregister the event handler
+	 */
+	static HandlerRegistration* const AddWildcardHandler(EventHandler<Event> & handler, const HandlerOptions & options = HandlerOptions()) {
+		return GetInstance()->addWildcardHandler(handler, options);
+	}
+
+
+	/**
+	 * \brief Links a caller-owned registration into the current instance
+	 *
+	 * @param registration The registration to link
+	 */
+	static void AddRegistration(EventRegistration & registration) {
+		GetInstance()->addRegistration(registration);
+	}
+
+
+	/**
+	 * \brief Fires an event on the current instance
+	 *
+	 * @param e The event to fire
+	 */
+	static void FireEvent(Event & e) {
+		GetInstance()->fireEvent(e);
+	}
+
+
+	/**
+	 * \brief Fires a two-phase event on the current instance
+	 *
+	 * @param proposal The cancelable proposal event
+	 * @param apply Called with the proposal to apply the change once it has been accepted
+	 * @return true if the proposal was accepted
+	 */
+	template <class Commit, class Proposal, class Apply>
+	static bool FireTwoPhase(Proposal & proposal, Apply apply) {
+		return GetInstance()->fireTwoPhase<Commit>(proposal, apply);
+	}
+
+
+	/**
+	 * \brief Seals the current instance
+	 */
+	static void Seal() {
+		GetInstance()->seal();
+	}
+
+
+	/**
+	 * \brief Unseals the current instance
+	 */
+	static void Unseal() {
+		GetInstance()->unseal();
+	}
+
+
+	/**
+	 * \brief Gets whether the current instance is sealed
+	 *
+	 * @return true if the EventBus is sealed
+	 */
+	static bool IsSealed() {
+		return GetInstance()->isSealed();
+	}
+
+
+	/**
+	 * \brief Starts timing the handlers of the current instance
+	 *
+	 * @param budget The time a handler may take for a single event
+	 * @param strikes The number of consecutive overruns before a handler is reported
+	 * @param background Executor that slow handlers are moved to, or nullptr to only report them
+	 * @param backlog The maximum number of copies waiting for a moved handler, or 0 for no limit
+	 */
+	static void SetWatchdog(std::chrono::nanoseconds budget, unsigned int strikes = 3, Executor * const background = nullptr, std::size_t backlog = 1024) {
+		GetInstance()->setWatchdog(budget, strikes, background, backlog);
+	}
+
+
+	/**
+	 * \brief Stops timing the handlers of the current instance
+	 */
+	static void ClearWatchdog() {
+		GetInstance()->clearWatchdog();
+	}
+
+
+	/**
+	 * \brief Gets the number of events the current instance dropped because a handler's backlog was full
+	 *
+	 * @return The number of dropped events
+	 */
+	static unsigned long long GetDroppedDeliveries() {
+		return GetInstance()->getDroppedDeliveries();
+	}
+
+
+	/**
+	 * \brief Sets the executor the current instance runs handlers on in parallel
+	 *
+	 * @param workers The executor, or nullptr to run every handler from FireEvent
+	 * @param count The number of handlers that may run on the executor at once
+	 */
+	static void SetWorkers(Executor * const workers, unsigned int count) {
+		GetInstance()->setWorkers(workers, count);
+	}
+
+
+	/**
+	 * \brief Enables the sticky event cache for an event type on the current instance
+	 */
+	template <class T>
+	static void EnableSticky() {
+		GetInstance()->enableSticky<T>();
+	}
+
+
+	/**
+	 * \brief Gets the cached sticky event for a sender from the current instance
+	 *
+	 * The returned event is the cached event itself, so it must not be changed or canceled.
+	 *
+	 * @param sender The sender object
+	 * @return The cached event, or nullptr if there isn't one
+	 */
+	template <class T>
+	static T* const GetStickyEvent(Object & sender) {
+		return GetInstance()->getStickyEvent<T>(sender);
+	}
+
+
+	/**
+	 * \brief Removes every cached sticky event for a sender from the current instance
+	 *
+	 * @param sender The sender object
+	 */
+	static void ClearStickyEvents(Object & sender) {
+		GetInstance()->clearStickyEvents(sender);
+	}
+
+
+	/**
+	 * \brief Forgets everything the current instance keeps for a sender
+	 *
+	 * @param sender The sender object
+	 */
+	static void ClearSender(Object & sender) {
+		GetInstance()->clearSender(sender);
+	}
+
+
 	/**
 	 * \brief Registers a new event handler to the EventBus with a source specifier
 	 *
@@ -74,29 +335,28 @@ public:
 	 * potentially inherit multiple event handlers, the template specifier will remove any ambiguity
 	 * as to which handler pointer is being referenced.
 	 *
+	 * Throws std::invalid_argument if the options deliver events through an executor and T isn't
+	 * copy constructible.
+	 *
 	 * @param handler The event handler class
 	 * @param sender The source sender object
+	 * @param options Optional registration settings
 	 * @return An EventRegistration pointer which can be used to unregister the event handler
 	 */
 	template <class T>
-	static HandlerRegistration* const AddHandler(EventHandler<T> & handler, Object & sender) {
-		EventBus* instance = GetInstance();
-
-		// Fetch the list of event pairs unique to this event type
-		Registrations* registrations = instance->handlers[typeid(T)];
-
-		// Create a new collection instance for this type if it hasn't been created yet
-		if (registrations == nullptr) {
-			registrations = new Registrations();
-			instance->handlers[typeid(T)] = registrations;
+	HandlerRegistration* const addHandler(EventHandler<T> & handler, Object & sender, const HandlerOptions & options = HandlerOptions()) {
+		// Posting needs a copy of the event, so reject the executor before anything is allocated
+		if (options.getExecutor() != nullptr && !std::is_copy_constructible<T>::value) {
+			throw std::invalid_argument("EventBus::addHandler: handlers of events that can't be copied can't be delivered through an executor");
 		}
 
-		// Create a new EventPair instance for this registration.
-		// This will group the handler, sender, and registration object into the same class
-		EventRegistration* registration = new EventRegistration(static_cast<void*>(&handler), registrations, &sender);
+		EventRegistration* registration = new EventRegistration(handler, &sender);
+		registration->configure<T>(options);
+		addRegistration(*registration);
 
-		// Add the registration object to the collection
-		registrations->push_back(registration);
+		if (options.getReplaySticky()) {
+			replaySticky(*registration);
+		}
 
 		return registration;
 	}
@@ -106,143 +366,1426 @@ public:
 	 * \brief Registers a new event handler to the EventBus with no source specified
 	 *
 	 * @param handler The event handler class
+	 * @param options Optional registration settings
 	 * @return An EventRegistration pointer which can be used to unregister the event handler
 	 */
 	template <class T>
-	static HandlerRegistration* const AddHandler(EventHandler<T> & handler) {
-		EventBus* instance = GetInstance();
+	HandlerRegistration* const addHandler(EventHandler<T> & handler, const HandlerOptions & options = HandlerOptions()) {
+		// Posting needs a copy of the event, so reject the executor before anything is allocated
+		if (options.getExecutor() != nullptr && !std::is_copy_constructible<T>::value) {
+			throw std::invalid_argument("EventBus::addHandler: handlers of events that can't be copied can't be delivered through an executor");
+		}
 
-		// Fetch the list of event pairs unique to this event type
-		Registrations* registrations = instance->handlers[typeid(T)];
+		EventRegistration* registration = new EventRegistration(handler, nullptr);
+		registration->configure<T>(options);
+		addRegistration(*registration);
 
-		// Create a new collection instance for this type if it hasn't been created yet
-		if (registrations == nullptr) {
-			registrations = new Registrations();
-			instance->handlers[typeid(T)] = registrations;
+		if (options.getReplaySticky()) {
+			replaySticky(*registration);
 		}
 
-		// Create a new EventPair instance for this registration.
-		// This will group the handler, sender, and registration object into the same class
-		EventRegistration* registration = new EventRegistration(static_cast<void*>(&handler), registrations, nullptr);
+		return registration;
+	}
 
-		// Add the registration object to the collection
-		registrations->push_back(registration);
 
-		return registration;
+	/**
+	 * \brief Registers a handler that receives every event fired by a sender, whatever its type
+	 *
+	 * Wildcard handlers are meant for auditing and debugging tools. They receive each event after
+	 * the handlers registered for its type, and typeid on the event gives its dynamic type. When no
+	 * wildcard handlers are registered, fireEvent pays a single branch for them.
+	 *
+	 * Wildcard handlers can't be delivered through an executor, since the event would be copied as
+	 * a plain Event, and are never demoted by the watchdog for the same reason.
+	 *
+	 * @param handler The event handler class
+	 * @param sender The source sender object
+	 * @param options Optional registration settings
+	 * @return An EventRegistration pointer which can be used to unregister the event handler
+	 */
+	HandlerRegistration* const addWildcardHandler(EventHandler<Event> & handler, Object & sender, const HandlerOptions & options = HandlerOptions()) {
+		return linkWildcard(handler, &sender, options);
+	}
+
+
+	/**
+	 * \brief Registers a handler that receives every event, whatever its type
+	 *
+	 * @param handler The event handler class
+	 * @param options Optional registration settings
+	 * @return An EventRegistration pointer which can be used to unregister the event handler
+	 */
+	HandlerRegistration* const addWildcardHandler(EventHandler<Event> & handler, const HandlerOptions & options = HandlerOptions()) {
+		return linkWildcard(handler, nullptr, options);
 	}
 
 
+	/**
+	 * \brief Links a caller-owned registration into the EventBus
+	 *
+	 * This is the allocation-free form of addHandler. The registration object can be embedded in
+	 * the handler itself (or in a coroutine frame) and is unlinked again when it is destroyed.
+	 * Linking a registration that is already registered has no effect.
+	 *
+	 * @param registration The registration to link
+	 */
+	void addRegistration(EventRegistration & registration);
+
+
 	/**
 	 * \brief Fires an event
 	 *
 	 * @param e The event to fire
 	 */
-	static void FireEvent(Event & e) {
-		EventBus* instance = GetInstance();
+	void fireEvent(Event & e) {
+		if (sealed) {
+			fireSealed(e);
+		} else {
+			TypeMap::iterator it = handlers.find(typeid(e));
 
-		Registrations* registrations = instance->handlers[typeid(e)];
+			// If there is no registrations list, then no handlers have been registered for this event
+			if (it != handlers.end()) {
+				it->second->dispatch(e);
+			}
+		}
 
-		// If the registrations list is null, then no handlers have been registered for this event
-		if (registrations == nullptr) {
-			return;
+		// Wildcard handlers see the event once the handlers for its type are done with it
+		if (wildcards.head != nullptr) {
+			wildcards.dispatch(e);
 		}
+	}
 
-		// Iterate through all the registered handlers and dispatch to each one if the sender
-		// matches the source or if the sender is not specified
-		for (auto & reg : *registrations) {
-			if ((reg->getSender() == nullptr) || (reg->getSender() == &e.getSender())) {
 
-				// This is where some magic happens. The void * handler is statically cast to an event handler
-				// of generic type Event and dispatched. The dispatch function will then do a dynamic
-				// cast to the correct event type so the matching onEvent method can be called
-				static_cast<EventHandler<Event>*>(reg->getHandler())->dispatch(e);
-			}
+	/**
+	 * \brief Fires a two-phase event
+	 *
+	 * The proposal event is fired first and carries the proposed change, so handlers can cancel it
+	 * before any state has been modified. If nothing cancels it, apply is called to make the change
+	 * and a Commit event constructed from the proposal is fired to let observers know the change
+	 * happened. A canceled proposal skips the commit phase entirely, and the Commit event isn't even
+	 * constructed when nothing handles it. Canceling the Commit event has no effect.
+	 *
+	 * \code
+	 * PlayerMoveEvent e(player, player, player.getX(), player.getY(), player.getZ(), x, y, z);
+	 * bus.fireTwoPhase<PlayerMovedEvent>(e, [&](PlayerMoveEvent & accepted) {
+	 *     player.setPosition(accepted.getNewX(), accepted.getNewY(), accepted.getNewZ());
+	 * });
+	 * \endcode
+	 *
+	 * @param proposal The cancelable proposal event
+	 * @param apply Called with the proposal to apply the change once it has been accepted
+	 * @return true if the proposal was accepted
+	 */
+	template <class Commit, class Proposal, class Apply>
+	bool fireTwoPhase(Proposal & proposal, Apply apply) {
+		static_assert(std::is_base_of<Event, Commit>::value, "fireTwoPhase<Commit>: Commit must be a class derived from Event");
+
+		fireEvent(proposal);
+
+		if (proposal.getCanceled()) {
+			return false;
+		}
+
+		apply(proposal);
+
+		if (isObserved(typeid(Commit))) {
+			Commit commit(proposal);
+			fireEvent(commit);
 		}
+
+		return true;
 	}
 
 
-private:
-	// Singleton class instance
-	static EventBus* instance;
+	/**
+	 * \brief Compiles the current registrations into an immutable dispatch table
+	 *
+	 * Once sealed, fireEvent finds the handlers for an event type with a single probe into a
+	 * perfect hash table and walks them in a contiguous array instead of following the linked
+	 * registration lists. Handlers can still be removed at any time. Handlers added while the
+	 * EventBus is sealed, including the registrations of awaiting coroutines, are kept aside and
+	 * called after the sealed handlers of their type, so the EventBus stays sealed. Each event
+	 * costs an extra lookup while there are any, and seal must be called again to fold them into
+	 * the table once a batch of registration changes is complete.
+	 *
+	 * Seal can't be called from inside a handler while a sealed dispatch is in progress. It throws
+	 * std::runtime_error, leaving the current table in place, if the event types can't be given a
+	 * slot each, which only happens if two of them share a hash code.
+	 */
+	void seal();
 
 
 	/**
-	 * \brief Registration class private to EventBus for registered event handlers
+	 * \brief Returns to dispatching through the mutable registration lists
 	 */
-	class EventRegistration : public HandlerRegistration
-	{
-	public:
-		typedef std::list<EventRegistration*> Registrations;
+	void unseal() {
+		sealed = false;
+	}
 
 
-		/**
-		 * \brief Represents a registration object for a registered event handler
-		 *
-		 * This object is stored in a collection with other handlers for the event type.
-		 *
-		 * @param handler The event handler
-		 * @param registrations The handler collection for this event type
-		 * @param sender The registered sender object
-		 */
-		EventRegistration(void * const handler, Registrations * const registrations, Object * const sender ) :
-			handler(handler),
-			registrations(registrations),
-			sender(sender),
-			registered(true)
-		{ }
+	/**
+	 * \brief Gets whether events are currently dispatched through the sealed table
+	 *
+	 * @return true if the EventBus is sealed
+	 */
+	bool isSealed() {
+		return sealed;
+	}
 
 
-		/**
-		 * \brief Empty virtual destructor
-		 */
-		virtual ~EventRegistration() { }
+	/**
+	 * \brief Enables the sticky event cache for an event type
+	 *
+	 * Once enabled, the EventBus keeps a copy of the last event of type T fired by each sender that
+	 * wasn't canceled. Handlers registered with HandlerOptions::replaySticky receive the cached
+	 * events as soon as they are added, so a late subscriber can catch up on the current state
+	 * without querying every sender. T must be copy constructible.
+	 */
+	template <class T>
+	void enableSticky() {
+		Registrations* registrations = getRegistrations(typeid(T));
 
+		if (registrations->sticky == nullptr) {
+			registrations->sticky = new TypedStickyEvents<T>();
 
-		/**
-		 * \brief Gets the event handler for this registration
-		 *
-		 * @return The event handler
-		 */
-		void * const getHandler() {
-			return handler;
+			// The sealed table doesn't cache events of this type yet
+			sealed = false;
 		}
+	}
 
 
-		/**
-		 * \brief Gets the sender object for this registration
-		 *
-		 * @return The registered sender object
-		 */
-		Object* const getSender() {
-			return sender;
+	/**
+	 * \brief Gets the cached sticky event for a sender
+	 *
+	 * The returned event is owned by the EventBus and is replaced by the next event from the sender.
+	 * It is the cached event itself, so it must not be changed or canceled.
+	 *
+	 * @param sender The sender object
+	 * @return The cached event, or nullptr if there isn't one
+	 */
+	template <class T>
+	T* const getStickyEvent(Object & sender) {
+		TypeMap::iterator it = handlers.find(typeid(T));
+
+		if (it == handlers.end() || it->second->sticky == nullptr) {
+			return nullptr;
 		}
 
+		return static_cast<T*>(it->second->sticky->find(sender));
+	}
 
-		/**
-		 * \brief Removes an event handler from the registration collection
-		 *
-		 * The event handler will no longer receive events for this event type
-		 */
-		virtual void removeHandler() {
-			if (registered) {
-				registrations->remove(this);
-				registered = false;
+
+	/**
+	 * \brief Removes every cached sticky event for a sender
+	 *
+	 * This should be called before a sender is destroyed, since cached events reference their sender.
+	 *
+	 * @param sender The sender object
+	 */
+	void clearStickyEvents(Object & sender) {
+		for (auto & pair : handlers) {
+			if (pair.second->sticky != nullptr) {
+				pair.second->sticky->erase(sender);
 			}
 		}
+	}
 
-	private:
-		void * const handler;
-		Registrations* const registrations;
-		Object* const sender;
 
-		bool registered;
-	};
+	/**
+	 * \brief Forgets everything the EventBus keeps for a sender
+	 *
+	 * Removes the sender's cached sticky events and its per-sender rate limit buckets. This should
+	 * be called before a sender is destroyed, so a new object at the same address doesn't inherit
+	 * its state.
+	 *
+	 * @param sender The sender object
+	 */
+	void clearSender(Object & sender) {
+		clearStickyEvents(sender);
 
-	typedef std::list<EventRegistration*> Registrations;
-	typedef std::unordered_map<std::type_index, std::list<EventRegistration*>*> TypeMap;
+		for (auto & pair : handlers) {
+			for (EventRegistration* reg = pair.second->head; reg != nullptr; reg = reg->next) {
+				reg->filter.forget(sender);
+			}
+		}
+
+		for (EventRegistration* reg = wildcards.head; reg != nullptr; reg = reg->next) {
+			reg->filter.forget(sender);
+		}
+	}
+
+
+	/**
+	 * \brief Starts timing handlers against a time budget
+	 *
+	 * Every handler added with addHandler is timed with the CPU cycle counter while it runs inside
+	 * fireEvent. Each time a handler has exceeded the budget strikes times in a row, the EventBus
+	 * fires a SlowHandlerEvent from itself. If a background executor is given, the handler is also
+	 * demoted: from then on it receives copies of its events on that executor instead of holding up
+	 * the thread that fires them. Since it only sees copies, a demoted handler can no longer cancel
+	 * events or change them for the handlers after it. Only handlers for copy constructible event
+	 * types can be demoted.
+	 *
+	 * A demoted handler also starts running on the executor's thread, possibly at the same time as
+	 * the thread that fires its events, so any state it shares with that thread needs to be
+	 * synchronized. A handler is demoted because it can't keep up, so its copies wait in a backlog
+	 * like one added with HandlerOptions::deliverOn. Once the backlog is full, new events are
+	 * dropped and counted by getDroppedDeliveries.
+	 *
+	 * The time measured includes any events the handler fires itself. Changing the watchdog unseals
+	 * the EventBus, so seal must be called again afterwards.
+	 *
+	 * @param budget The time a handler may take for a single event
+	 * @param strikes The number of consecutive overruns before a handler is reported
+	 * @param background Executor that slow handlers are moved to, or nullptr to only report them
+	 * @param backlog The maximum number of copies waiting for a moved handler, or 0 for no limit
+	 */
+	void setWatchdog(std::chrono::nanoseconds budget, unsigned int strikes = 3, Executor * const background = nullptr, std::size_t backlog = 1024) {
+		const std::uint64_t ticks = CycleClock::ToTicks(budget);
+
+		watchdogTicks = ticks > 0 ? ticks : 1;
+		watchdogStrikes = strikes > 0 ? strikes : 1;
+		watchdogExecutor = background;
+		watchdogBacklog = backlog;
+		refreshRegistrations();
+	}
+
+
+	/**
+	 * \brief Stops timing handlers
+	 *
+	 * Handlers that have already been demoted keep running on the background executor until they
+	 * are removed.
+	 */
+	void clearWatchdog() {
+		watchdogTicks = 0;
+		watchdogStrikes = 0;
+		watchdogExecutor = nullptr;
+		refreshRegistrations();
+	}
+
+
+	/**
+	 * \brief Gets the number of events dropped because a handler's backlog was full
+	 *
+	 * Only handlers delivered through an executor with a backlog drop events.
+	 *
+	 * @return The number of dropped events
+	 */
+	unsigned long long getDroppedDeliveries() const {
+		return droppedDeliveries.load(std::memory_order_relaxed);
+	}
+
+
+	/**
+	 * \brief Sets the executor handlers are run on in parallel
+	 *
+	 * Once the EventBus has workers, an event whose handlers have declared the resources they read
+	 * and write with HandlerOptions::reads and HandlerOptions::writes is dispatched through a
+	 * dependency graph. Handlers that don't conflict run at the same time on the workers and on
+	 * the thread that fired the event, while handlers that conflict keep their registration order,
+	 * so the result is the same as calling them one after another. A handler that doesn't declare
+	 * anything conflicts with every other handler. fireEvent still returns after every handler
+	 * has run.
+	 *
+	 * Every handler that declares its resources also reads the event itself, including whether it
+	 * was canceled. A handler that cancels or changes the event must declare that with
+	 * HandlerOptions::cancels, so the handlers after it still see the event the way they would if
+	 * the handlers ran one after another.
+	 *
+	 * Handlers run in parallel must not fire events, add handlers or remove handlers on the same
+	 * EventBus. They aren't timed by the watchdog. Changing the workers unseals the
+	 * EventBus, so seal must be called again afterwards.
+	 *
+	 * @param workers The executor, or nullptr to run every handler from fireEvent
+	 * @param count The number of handlers that may run on the executor at once
+	 */
+	void setWorkers(Executor * const workers, unsigned int count) {
+		this->workers = workers;
+		workerCount = workers != nullptr ? count : 0;
+
+		// The sealed table caches which types are dispatched in parallel
+		sealed = false;
+	}
+
+
+	/**
+	 * \brief Registration class for registered event handlers
+	 *
+	 * Registrations are linked directly into the handler list of their event type, so adding and
+	 * removing a handler doesn't allocate any list nodes and removal takes constant time.
+	 */
+	class EventRegistration : public HandlerRegistration
+	{
+	public:
+		/**
+		 * \brief Represents a registration object for an event handler
+		 *
+		 * The registration isn't linked to the EventBus until it is passed to AddRegistration.
+		 *
+		 * @param handler The event handler
+		 * @param sender The registered sender object, or nullptr to receive events from any sender
+		 */
+		template <class T>
+		EventRegistration(EventHandler<T> & handler, Object * const sender) :
+			handler(static_cast<void*>(&handler)),
+			sender(sender),
+			type(typeid(T)),
+			registrations(nullptr),
+			previous(nullptr),
+			next(nullptr),
+			sequence(0),
+			sealedIndex(NotSealed),
+			unsealed(false),
+			plain(true),
+			watched(false),
+			overruns(0),
+			executor(nullptr),
+			post(nullptr),
+			backlog(0)
+		{ }
+
+
+		/**
+		 * \brief Virtual destructor, unlinks the registration if it is still registered
+		 */
+		virtual ~EventRegistration() {
+			removeHandler();
+		}
+
+
+		/**
+		 * \brief Gets the event handler for this registration
+		 *
+		 * @return The event handler
+		 */
+		void * const getHandler() {
+			return handler;
+		}
+
+
+		/**
+		 * \brief Gets the sender object for this registration
+		 *
+		 * @return The registered sender object
+		 */
+		Object* const getSender() {
+			return sender;
+		}
+
+
+		/**
+		 * \brief Gets whether the registration is currently linked into the EventBus
+		 *
+		 * @return true if the handler is registered
+		 */
+		bool isRegistered() {
+			return registrations != nullptr;
+		}
+
+
+		/**
+		 * \brief Removes an event handler from the registration collection
+		 *
+		 * The event handler will no longer receive events for this event type. It is safe to call
+		 * this from inside an event handler while the event is being dispatched.
+		 */
+		virtual void removeHandler();
+
+	private:
+		friend class EventBus;
+
+		// Registrations are linked by address so they can't be copied
+		EventRegistration(const EventRegistration &) = delete;
+		EventRegistration & operator=(const EventRegistration &) = delete;
+
+		void * const handler;
+		Object* const sender;
+		const std::type_info & type;
+
+		Registrations* registrations;
+		EventRegistration* previous;
+		EventRegistration* next;
+		unsigned long long sequence;
+
+		// Position of the registration in the sealed dispatch table
+		static const std::size_t NotSealed = static_cast<std::size_t>(-1);
+		std::size_t sealedIndex;
+
+		// Set when the registration was added while sealed and isn't in the sealed table yet
+		bool unsealed;
+
+		// Set when the handler is called directly, without a filter, executor or timing
+		bool plain;
+
+		// Set when the watchdog times the handler, with the number of overruns since the last report
+		bool watched;
+		unsigned int overruns;
+
+		// Resources the handler reads and writes, or nullptr if it hasn't declared any
+		std::unique_ptr<ResourceAccess> access;
+
+		// Sampling and rate limits from the registration options
+		DeliveryFilter filter;
+
+		/**
+		 * \brief State shared by a registration and the copies of events waiting on its executor
+		 *
+		 * The mutex is held while the executor runs the handler, so removing the handler waits for
+		 * a call that is already running. It's recursive so the handler can remove itself.
+		 */
+		struct DeliveryState {
+			DeliveryState(std::size_t backlog) :
+				alive(true),
+				backlog(backlog),
+				queued(0)
+			{ }
+
+			std::recursive_mutex mutex;
+			bool alive;
+			const std::size_t backlog;
+			std::atomic<std::size_t> queued;
+		};
+
+		// Executor the handler is delivered on, with the function that posts a copy of an event,
+		// the maximum number of copies waiting and the state that the waiting copies share
+		Executor* executor;
+		void (*post)(EventRegistration &, Event &);
+		std::size_t backlog;
+		std::shared_ptr<DeliveryState> delivery;
+
+
+		/**
+		 * \brief Applies the registration options
+		 *
+		 * @param options The registration options
+		 */
+		template <class T>
+		void configure(const HandlerOptions & options) {
+			filter.configure(options);
+			executor = options.getExecutor();
+			post = PostFunction<T>(std::is_copy_constructible<T>());
+			backlog = options.getBacklog();
+			watched = true;
+
+			if (!options.getAccess().empty()) {
+				access.reset(new ResourceAccess(options.getAccess()));
+				access->read(ResourceAccess::EventResource());
+			}
+		}
+
+
+		/**
+		 * \brief Works out whether the handler can be called directly
+		 *
+		 * @param timed true if the watchdog is enabled
+		 */
+		void refresh(bool timed) {
+			plain = !filter.isActive() && executor == nullptr && !(timed && watched);
+		}
+
+
+		/**
+		 * \brief Delivers an event to a registration that has a filter, an executor or is timed
+		 *
+		 * @param e The event being dispatched
+		 * @param timed false to skip the watchdog, for handlers run in parallel
+		 */
+		void deliver(Event & e, bool timed = true) {
+			if (filter.isActive() && !filter.accept(e.getSender())) {
+				return;
+			}
+
+			if (executor != nullptr) {
+				post(*this, e);
+			} else if (timed && watched && registrations->bus.watchdogTicks != 0 && !registrations->bus.reporting) {
+				registrations->bus.invokeTimed(*this, e);
+			} else {
+				Invoke(handler, e);
+			}
+		}
+	};
+
+
+private:
+	// Default class instance
+	static EventBus* instance;
+
+	// Instance bound to the current thread, overrides the default instance
+	static thread_local EventBus* threadInstance;
+
+	// Registration lists point back to the bus, so it can't be copied
+	EventBus(const EventBus &) = delete;
+	EventBus & operator=(const EventBus &) = delete;
+
+
+	/**
+	 * \brief Calls a registered handler
+	 *
+	 * This is where some magic happens. The void * handler is statically cast to an event handler
+	 * of generic type Event and dispatched. The dispatch function will then do a dynamic
+	 * cast to the correct event type so the matching onEvent method can be called
+	 *
+	 * @param handler The registered handler
+	 * @param e The event to dispatch
+	 */
+	static void Invoke(void * const handler, Event & e) {
+		static_cast<EventHandler<Event>*>(handler)->dispatch(e);
+	}
+
+
+	/**
+	 * \brief Copy of an event waiting in an executor's queue for an executor-affine handler
+	 */
+	template <class T>
+	struct Delivery : public Executor::Task {
+		Delivery(EventRegistration & registration, T & e) :
+			Task(&Run),
+			handler(static_cast<EventHandler<T>*>(registration.handler)),
+			state(registration.delivery),
+			event(e)
+		{ }
+
+		static void Run(Task * task, bool run) {
+			std::unique_ptr<Delivery> delivery(static_cast<Delivery*>(task));
+			EventRegistration::DeliveryState & state = *delivery->state;
+
+			state.queued.fetch_sub(1, std::memory_order_relaxed);
+
+			if (run) {
+				std::lock_guard<std::recursive_mutex> lock(state.mutex);
+
+				if (state.alive) {
+					delivery->handler->onEvent(delivery->event);
+				}
+			}
+		}
+
+		EventHandler<T>* const handler;
+		const std::shared_ptr<EventRegistration::DeliveryState> state;
+		T event;
+	};
+
+
+	/**
+	 * \brief Posts a copy of an event to the executor of a registration
+	 *
+	 * @param registration The executor-affine registration
+	 * @param e The event to deliver
+	 */
+	template <class T>
+	static void PostDelivery(EventRegistration & registration, Event & e) {
+		EventRegistration::DeliveryState & state = *registration.delivery;
+
+		if (state.backlog != 0 && state.queued.load(std::memory_order_relaxed) >= state.backlog) {
+			registration.registrations->bus.droppedDeliveries.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		state.queued.fetch_add(1, std::memory_order_relaxed);
+		registration.executor->post(*new Delivery<T>(registration, static_cast<T &>(e)));
+	}
+
+
+	/**
+	 * \brief Picks the post function for an event type, events that can't be copied can't be posted
+	 *
+	 * @return The post function, or nullptr
+	 */
+	template <class T>
+	static void (*PostFunction(std::true_type))(EventRegistration &, Event &) {
+		return &PostDelivery<T>;
+	}
+
+	template <class T>
+	static void (*PostFunction(std::false_type))(EventRegistration &, Event &) {
+		return nullptr;
+	}
+
+
+	/**
+	 * \brief Handler call being timed by the watchdog, nested calls form a stack
+	 *
+	 * The registration is cleared if it is removed while its handler runs.
+	 */
+	struct Timing {
+		Timing(EventBus & bus, EventRegistration & registration) :
+			bus(bus),
+			outer(bus.timings),
+			registration(&registration) {
+			bus.timings = this;
+		}
+
+		~Timing() {
+			bus.timings = outer;
+		}
+
+		EventBus & bus;
+		Timing* const outer;
+		EventRegistration* registration;
+	};
+
+
+	/**
+	 * \brief Calls a handler and charges the time it took against the watchdog budget
+	 *
+	 * @param registration The registration of the handler
+	 * @param e The event to dispatch
+	 */
+	void invokeTimed(EventRegistration & registration, Event & e) {
+		Timing timing(*this, registration);
+		const std::uint64_t start = CycleClock::Now();
+
+		Invoke(registration.handler, e);
+
+		const std::uint64_t elapsed = CycleClock::Now() - start;
+
+		// The handler may have removed and destroyed its own registration
+		if (timing.registration == nullptr) {
+			return;
+		}
+
+		// Strikes have to be consecutive, so a call within the budget clears them
+		if (elapsed > watchdogTicks) {
+			overrun(registration, elapsed);
+		} else {
+			registration.overruns = 0;
+		}
+	}
+
+
+	/**
+	 * \brief Records a call that exceeded the budget, reporting and demoting the handler once it has struck out
+	 *
+	 * The strikes are reset once the handler is reported or by any call that stays within the budget.
+	 *
+	 * @param registration The registration of the slow handler
+	 * @param elapsed The number of ticks the call took
+	 */
+	void overrun(EventRegistration & registration, std::uint64_t elapsed) {
+		if (++registration.overruns < watchdogStrikes) {
+			return;
+		}
+
+		const unsigned int overruns = registration.overruns;
+		bool demoted = false;
+
+		registration.overruns = 0;
+
+		if (watchdogExecutor != nullptr && registration.post != nullptr) {
+			registration.executor = watchdogExecutor;
+			registration.backlog = watchdogBacklog;
+			registration.delivery = std::make_shared<EventRegistration::DeliveryState>(watchdogBacklog);
+			demoted = true;
+		}
+
+		if (!isObserved(typeid(SlowHandlerEvent))) {
+			return;
+		}
+
+		// Handlers of the report aren't timed, so a slow one can't report itself over and over
+		struct Guard {
+			Guard(bool & flag) : flag(flag), outer(flag) { flag = true; }
+			~Guard() { flag = outer; }
+			bool & flag;
+			const bool outer;
+		} guard(reporting);
+
+		SlowHandlerEvent report(*this, registration, CycleClock::ToDuration(elapsed), overruns, demoted);
+		fireEvent(report);
+	}
+
+
+	/**
+	 * \brief Recomputes which registrations can be called directly after the watchdog changed
+	 */
+	void refreshRegistrations() {
+		for (auto & pair : handlers) {
+			for (EventRegistration* reg = pair.second->head; reg != nullptr; reg = reg->next) {
+				reg->refresh(watchdogTicks != 0);
+			}
+		}
+
+		for (EventRegistration* reg = wildcards.head; reg != nullptr; reg = reg->next) {
+			reg->refresh(watchdogTicks != 0);
+		}
+
+		// The sealed table still calls the handlers the old way
+		sealed = false;
+	}
+
+
+	/**
+	 * \brief Intrusive list of the registrations for a single event type
+	 *
+	 * Every dispatch in progress keeps a cursor on the stack which is advanced past any
+	 * registration that gets removed underneath it. Registrations are stamped with a sequence
+	 * number so handlers added during a dispatch don't receive the event that is being fired.
+	 */
+	class Registrations
+	{
+	public:
+		Registrations(EventBus & bus, const std::type_info & type) :
+			bus(bus),
+			type(type),
+			head(nullptr),
+			tail(nullptr),
+			cursors(nullptr),
+			sequence(0),
+			unsealed(nullptr),
+			sticky(nullptr),
+			declared(0)
+		{ }
+
+
+		/**
+		 * \brief Detaches all registrations still in the list
+		 */
+		~Registrations() {
+			while (head != nullptr) {
+				unlink(*head);
+			}
+
+			delete sticky;
+		}
+
+
+		/**
+		 * \brief Appends a registration to the end of the list
+		 *
+		 * @param registration The registration to add
+		 */
+		void link(EventRegistration & registration) {
+			// Deliveries left over from an earlier registration stay canceled
+			if (registration.executor != nullptr) {
+				registration.delivery = std::make_shared<EventRegistration::DeliveryState>(registration.backlog);
+			}
+
+			registration.refresh(bus.watchdogTicks != 0);
+			registration.registrations = this;
+
+			if (registration.access) {
+				++declared;
+			}
+
+			plan.reset();
+			registration.sequence = ++sequence;
+			registration.previous = tail;
+			registration.next = nullptr;
+
+			if (tail != nullptr) {
+				tail->next = &registration;
+			} else {
+				head = &registration;
+			}
+
+			tail = &registration;
+		}
+
+
+		/**
+		 * \brief Removes a registration from the list
+		 *
+		 * @param registration The registration to remove
+		 */
+		void unlink(EventRegistration & registration) {
+			// Step any in-progress dispatch over the registration being removed
+			for (Cursor* cursor = cursors; cursor != nullptr; cursor = cursor->outer) {
+				if (cursor->next == &registration) {
+					cursor->next = registration.next;
+				}
+			}
+
+			if (registration.previous != nullptr) {
+				registration.previous->next = registration.next;
+			} else {
+				head = registration.next;
+			}
+
+			if (registration.next != nullptr) {
+				registration.next->previous = registration.previous;
+			} else {
+				tail = registration.previous;
+			}
+
+			// Leave a hole in the sealed table so it stops calling the handler
+			if (registration.sealedIndex != EventRegistration::NotSealed) {
+				bus.sealedHandlers[registration.sealedIndex].handler = nullptr;
+				registration.sealedIndex = EventRegistration::NotSealed;
+			}
+
+			// Registrations added since the last seal are at the end of the list
+			if (registration.unsealed) {
+				if (unsealed == &registration) {
+					unsealed = registration.next;
+				}
+
+				registration.unsealed = false;
+				--bus.unsealedCount;
+			}
+
+			// Tell the watchdog not to touch the registration once its handler returns
+			for (Timing* timing = bus.timings; timing != nullptr; timing = timing->outer) {
+				if (timing->registration == &registration) {
+					timing->registration = nullptr;
+				}
+			}
+
+			// Drop any deliveries the handler's executor hasn't run yet, and wait for one it's running
+			if (registration.delivery) {
+				std::lock_guard<std::recursive_mutex> lock(registration.delivery->mutex);
+				registration.delivery->alive = false;
+			}
+
+			if (registration.access) {
+				--declared;
+			}
+
+			plan.reset();
+
+			registration.registrations = nullptr;
+			registration.previous = nullptr;
+			registration.next = nullptr;
+		}
+
+
+		/**
+		 * \brief Dispatches an event to every registration whose sender matches the event sender
+		 *
+		 * @param e The event to dispatch
+		 */
+		void dispatch(Event & e) {
+			if (declared != 0 && bus.workers != nullptr) {
+				dispatchParallel(e);
+				return;
+			}
+
+			deliverFrom(head, sequence, e);
+
+			if (sticky != nullptr && !e.getCanceled()) {
+				sticky->store(e);
+			}
+		}
+
+
+		/**
+		 * \brief Delivers an event to the registrations from a point in the list to its end
+		 *
+		 * @param first The first registration to deliver to
+		 * @param last The sequence number of the last registration that was linked when the event was fired
+		 * @param e The event to dispatch
+		 */
+		void deliverFrom(EventRegistration * const first, const unsigned long long last, Event & e) {
+			Cursor cursor(*this, first);
+
+			// Iterate through all the registered handlers and dispatch to each one if the sender
+			// matches the source or if the sender is not specified
+			while (cursor.next != nullptr && cursor.next->sequence <= last) {
+				EventRegistration* reg = cursor.next;
+				cursor.next = reg->next;
+
+				if ((reg->sender == nullptr) || (reg->sender == &e.getSender())) {
+					if (reg->plain) {
+						Invoke(reg->handler, e);
+					} else {
+						reg->deliver(e);
+					}
+				}
+			}
+		}
+
+
+		/**
+		 * \brief Dispatches an event through the dependency graph of the registrations
+		 *
+		 * @param e The event to dispatch
+		 */
+		void dispatchParallel(Event & e) {
+			if (!plan) {
+				std::vector<const ResourceAccess*> access;
+				plan = std::make_shared<Plan>();
+
+				for (EventRegistration* reg = head; reg != nullptr; reg = reg->next) {
+					plan->registrations.push_back(reg);
+					access.push_back(reg->access.get());
+				}
+
+				plan->schedule.reset(new ParallelSchedule(access));
+			}
+
+			// Hold on to the plan in case it is rebuilt by a nested dispatch
+			std::shared_ptr<Plan> current = plan;
+			Run run = { *current, e };
+
+			current->schedule->run(*bus.workers, bus.workerCount, &RunNode, &run);
+
+			if (sticky != nullptr && !e.getCanceled()) {
+				sticky->store(e);
+			}
+		}
+
+	private:
+		friend class EventBus;
+
+		/**
+		 * \brief Registrations in list order with the dependency graph built from their access
+		 */
+		struct Plan {
+			std::vector<EventRegistration*> registrations;
+			std::unique_ptr<ParallelSchedule> schedule;
+		};
+
+
+		/**
+		 * \brief Event being dispatched through a plan
+		 */
+		struct Run {
+			Plan & plan;
+			Event & e;
+		};
+
+
+		/**
+		 * \brief Calls a single handler of a plan, on whichever thread picked it up
+		 *
+		 * @param context The run
+		 * @param node The index of the registration
+		 */
+		static void RunNode(void * context, std::size_t node) {
+			Run & run = *static_cast<Run*>(context);
+			EventRegistration* reg = run.plan.registrations[node];
+
+			if ((reg->sender == nullptr) || (reg->sender == &run.e.getSender())) {
+				if (reg->plain) {
+					Invoke(reg->handler, run.e);
+				} else {
+					reg->deliver(run.e, false);
+				}
+			}
+		}
+
+
+		/**
+		 * \brief Position of an in-progress dispatch, nested dispatches form a stack
+		 */
+		struct Cursor {
+// GCC 12 warns when this is inlined into fireEvent for the wildcard list, which is a member of the
+// bus, but the destructor always unlinks the cursor before it goes out of scope
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 12
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdangling-pointer"
+#endif
+			Cursor(Registrations & list, EventRegistration * const first) :
+				list(list),
+				outer(list.cursors),
+				next(first) {
+				list.cursors = this;
+			}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 12
+#pragma GCC diagnostic pop
+#endif
+
+			~Cursor() {
+				list.cursors = outer;
+			}
+
+			Registrations & list;
+			Cursor* const outer;
+			EventRegistration* next;
+		};
+
+		EventBus & bus;
+		const std::type_info & type;
+		EventRegistration* head;
+		EventRegistration* tail;
+		Cursor* cursors;
+		unsigned long long sequence;
+
+		// First registration added since the bus was sealed, the rest follow it
+		EventRegistration* unsealed;
+
+		// Last event per sender, only set for sticky event types
+		StickyEvents* sticky;
+
+		// Number of registrations that declared their access, and the graph built from them
+		unsigned int declared;
+		std::shared_ptr<Plan> plan;
+	};
+
+	/**
+	 * \brief Slot in the sealed type table, covering a range of the sealed handler array
+	 */
+	struct SealedType {
+		std::size_t hash;
+		const std::type_info* type;
+		std::size_t begin;
+		std::size_t end;
+		StickyEvents* sticky;
+		Registrations* parallel;
+	};
+
+
+	/**
+	 * \brief Entry in the sealed handler array, a null handler marks a removed registration
+	 *
+	 * The registration is only set when it has to be delivered through EventRegistration::deliver,
+	 * because it has sampling, rate limits, an executor or is timed by the watchdog.
+	 */
+	struct SealedHandler {
+		void* handler;
+		Object* sender;
+		EventRegistration* extended;
+	};
+
+
+	/**
+	 * \brief Maps a type hash to its slot in the sealed type table
+	 *
+	 * @param hash The type hash code
+	 * @return The slot index
+	 */
+	std::size_t sealedSlot(std::size_t hash) {
+		return (hash * sealedMultiplier) >> sealedShift;
+	}
+
+
+	/**
+	 * \brief Dispatches an event through the sealed table
+	 *
+	 * @param e The event to fire
+	 */
+	void fireSealed(Event & e) {
+		const std::type_info & type = typeid(e);
+		const std::size_t hash = type.hash_code();
+		const SealedType & slot = sealedTypes[sealedSlot(hash)];
+
+		// Handlers added since the table was built, bounded like a list dispatch so handlers added
+		// by the sealed handlers don't receive this event
+		Registrations* late = unsealedCount != 0 ? getUnsealed(type) : nullptr;
+		const unsigned long long last = late != nullptr ? late->sequence : 0;
+
+		if (slot.hash != hash || slot.type == nullptr || *slot.type != type) {
+			if (late != nullptr) {
+				late->deliverFrom(late->unsealed, last, e);
+			}
+
+			return;
+		}
+
+		// Types with declared access are dispatched through their dependency graph
+		if (slot.parallel != nullptr) {
+			slot.parallel->dispatchParallel(e);
+			return;
+		}
+
+		{
+			// Keep the table alive while it is being walked
+			struct Guard {
+				Guard(unsigned int & count) : count(count) { ++count; }
+				~Guard() { --count; }
+				unsigned int & count;
+			} guard(sealedDispatches);
+
+			const SealedHandler* handlers = sealedHandlers.data();
+			Object* const sender = &e.getSender();
+
+			for (std::size_t i = slot.begin; i < slot.end; ++i) {
+				const SealedHandler & entry = handlers[i];
+
+				if (entry.handler != nullptr && (entry.sender == nullptr || entry.sender == sender)) {
+					if (entry.extended == nullptr) {
+						Invoke(entry.handler, e);
+					} else {
+						entry.extended->deliver(e);
+					}
+				}
+			}
+		}
+
+		if (late != nullptr) {
+			late->deliverFrom(late->unsealed, last, e);
+		}
+
+		if (slot.sticky != nullptr && !e.getCanceled()) {
+			slot.sticky->store(e);
+		}
+	}
+
+
+	/**
+	 * \brief Gets the registration list of a type if it has handlers that were added since the table was built
+	 *
+	 * @param type The event type
+	 * @return The registration list, or nullptr
+	 */
+	Registrations* getUnsealed(const std::type_info & type) {
+		TypeMap::iterator it = handlers.find(type);
+
+		return it != handlers.end() && it->second->unsealed != nullptr ? it->second : nullptr;
+	}
+
+
+	/**
+	 * \brief Gets whether firing an event type would reach a handler or a sticky cache
+	 *
+	 * @param type The event type
+	 * @return true if the event type has handlers or is sticky
+	 */
+	bool isObserved(const std::type_info & type) {
+		if (wildcards.head != nullptr) {
+			return true;
+		}
+
+		// The lists are always up to date, the table can only be used if nothing was added since it was built
+		if (sealed && unsealedCount == 0) {
+			const std::size_t hash = type.hash_code();
+			const SealedType & slot = sealedTypes[sealedSlot(hash)];
+
+			return slot.hash == hash && slot.type != nullptr && *slot.type == type
+				&& (slot.begin != slot.end || slot.sticky != nullptr);
+		}
+
+		TypeMap::iterator it = handlers.find(type);
+
+		return it != handlers.end() && (it->second->head != nullptr || it->second->sticky != nullptr);
+	}
+
+
+	/**
+	 * \brief Gets the registration list for an event type, creating it if it doesn't exist yet
+	 *
+	 * @param type The event type
+	 * @return The registration list
+	 */
+	Registrations* getRegistrations(const std::type_info & type) {
+		// Fetch the list of registrations unique to this event type
+		Registrations* & registrations = handlers[std::type_index(type)];
+
+		// Create a new collection instance for this type if it hasn't been created yet
+		if (registrations == nullptr) {
+			registrations = new Registrations(*this, type);
+		}
+
+		return registrations;
+	}
+
+
+	/**
+	 * \brief Creates a wildcard registration and links it into the wildcard list
+	 *
+	 * @param handler The event handler
+	 * @param sender The registered sender object, or nullptr to receive events from any sender
+	 * @param options The registration options
+	 * @return The new registration
+	 */
+	HandlerRegistration* const linkWildcard(EventHandler<Event> & handler, Object * const sender, const HandlerOptions & options) {
+		if (options.getExecutor() != nullptr) {
+			throw std::invalid_argument("EventBus::addWildcardHandler: wildcard handlers can't be delivered through an executor");
+		}
+
+		EventRegistration* registration = new EventRegistration(handler, sender);
+		registration->configure<Event>(options);
+
+		// Posting a copy would slice the event, so the watchdog can't demote the handler either
+		registration->post = nullptr;
+
+		wildcards.link(*registration);
+
+		return registration;
+	}
+
+
+	/**
+	 * \brief Delivers the cached sticky events that match a new registration
+	 *
+	 * Each handler gets its own copy of the events, never the cached instances.
+	 *
+	 * @param registration The registration to replay the events to
+	 */
+	void replaySticky(EventRegistration & registration) {
+		StickyEvents* sticky = registration.registrations->sticky;
+
+		if (sticky == nullptr) {
+			return;
+		}
+
+		StickyEvents::Snapshot snapshot;
+		sticky->collect(registration.sender, snapshot);
+
+		for (auto & e : snapshot) {
+			// Stop if the handler removed itself during the replay
+			if (!registration.isRegistered()) {
+				break;
+			}
+
+			if (registration.plain) {
+				Invoke(registration.handler, *e);
+			} else {
+				registration.deliver(*e);
+			}
+		}
+	}
+
+	typedef std::unordered_map<std::type_index, Registrations*> TypeMap;
 
 	TypeMap handlers;
 
+	bool sealed;
+	unsigned int sealedDispatches;
+	std::vector<SealedType> sealedTypes;
+	std::vector<SealedHandler> sealedHandlers;
+	std::size_t sealedMultiplier;
+	unsigned int sealedShift;
+
+	// Number of registrations added since the table was built
+	std::size_t unsealedCount;
+
+	// Watchdog budget in cycle clock ticks, zero when handlers aren't timed
+	std::uint64_t watchdogTicks;
+	unsigned int watchdogStrikes;
+	Executor* watchdogExecutor;
+	std::size_t watchdogBacklog;
+	Timing* timings;
+	bool reporting;
+
+	// Events dropped because the backlog of an executor-affine handler was full
+	std::atomic<unsigned long long> droppedDeliveries;
+
+	// Executor for handlers run in parallel, and the number of handlers it may run at once
+	Executor* workers;
+	unsigned int workerCount;
+
+	// Handlers for every event type, declared last so they are detached before the rest of the bus goes away
+	Registrations wildcards;
+
 };
 
+
+inline void EventBus::addRegistration(EventRegistration & registration) {
+	if (registration.isRegistered()) {
+		return;
+	}
+
+	Registrations* registrations = getRegistrations(registration.type);
+	registrations->link(registration);
+
+	// The sealed table doesn't know about the new handler, keep it aside until the table is rebuilt
+	if (sealed) {
+		if (registrations->unsealed == nullptr) {
+			registrations->unsealed = &registration;
+		}
+
+		registration.unsealed = true;
+		++unsealedCount;
+	}
+}
+
+
+inline void EventBus::seal() {
+	if (sealedDispatches != 0) {
+		throw std::logic_error("EventBus::seal: can't rebuild the dispatch table while it's dispatching");
+	}
+
+	std::vector<Registrations*> types;
+
+	// Collect the event types that have handlers or a sticky cache
+	for (auto & pair : handlers) {
+		if (pair.second->head != nullptr || pair.second->sticky != nullptr) {
+			types.push_back(pair.second);
+		}
+	}
+
+	// Search for a multiplier that maps every type hash to its own slot. The table starts at twice
+	// the number of types and doubles whenever a handful of multipliers all collide. Types that
+	// share a hash code can never be separated, so the search gives up after a few doublings.
+	const unsigned int bits = sizeof(std::size_t) * 8;
+	unsigned int size = 1;
+
+	while ((std::size_t(1) << size) < types.size() * 2) {
+		++size;
+	}
+
+	const unsigned int maxSize = size + 8 < bits ? size + 8 : bits - 1;
+	std::size_t multiplier = 0;
+	bool found = false;
+	std::vector<bool> used;
+
+	while (!found && size <= maxSize) {
+		for (std::size_t attempt = 0; attempt < 32 && !found; ++attempt) {
+			multiplier = static_cast<std::size_t>(0x9E3779B97F4A7C15ull) * (2 * attempt + 1);
+
+			used.assign(std::size_t(1) << size, false);
+			found = true;
+
+			for (Registrations* registrations : types) {
+				std::size_t slot = (registrations->type.hash_code() * multiplier) >> (bits - size);
+
+				if (used[slot]) {
+					found = false;
+					break;
+				}
+
+				used[slot] = true;
+			}
+		}
+
+		if (!found) {
+			++size;
+		}
+	}
+
+	if (!found) {
+		throw std::runtime_error("EventBus::seal: can't give every event type its own slot in the dispatch table");
+	}
+
+	sealedMultiplier = multiplier;
+	sealedShift = bits - size;
+
+	// Number the registrations in order, including the ones that were kept aside since the last seal
+	std::size_t count = 0;
+
+	for (Registrations* registrations : types) {
+		registrations->unsealed = nullptr;
+
+		for (EventRegistration* reg = registrations->head; reg != nullptr; reg = reg->next) {
+			reg->sealedIndex = count++;
+			reg->unsealed = false;
+		}
+	}
+
+	unsealedCount = 0;
+
+	// Lay out the handlers of each type contiguously in registration order
+	SealedType empty = { 0, nullptr, 0, 0, nullptr, nullptr };
+	sealedTypes.assign(std::size_t(1) << size, empty);
+	sealedHandlers.clear();
+	sealedHandlers.reserve(count);
+
+	for (Registrations* registrations : types) {
+		SealedType & slot = sealedTypes[sealedSlot(registrations->type.hash_code())];
+
+		slot.hash = registrations->type.hash_code();
+		slot.type = &registrations->type;
+		slot.sticky = registrations->sticky;
+		slot.parallel = registrations->declared != 0 && workers != nullptr ? registrations : nullptr;
+		slot.begin = sealedHandlers.size();
+
+		for (EventRegistration* reg = registrations->head; reg != nullptr; reg = reg->next) {
+			SealedHandler entry = { reg->handler, reg->sender, reg->plain ? nullptr : reg };
+			sealedHandlers.push_back(entry);
+		}
+
+		slot.end = sealedHandlers.size();
+	}
+
+	sealed = true;
+}
+
+
+inline void EventBus::EventRegistration::removeHandler() {
+	if (registrations != nullptr) {
+		registrations->unlink(*this);
+	}
+}
+
 #endif /* _SRC_EVENT_EVENT_BUS_HPP_ */
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_EVENT_LOOP_HPP_
+#define _SRC_EVENT_EVENT_LOOP_HPP_
+
+#include "Executor.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+/**
+ * \brief Executor for a thread that owns some handlers, such as a render or network loop
+ *
+ * Tasks posted from any thread are pushed onto a lock-free inbox. The owning thread takes the
+ * whole inbox at once with runPending, or blocks in run until work arrives. Producers only wake
+ * the owner when they post to an empty inbox, so a burst of events costs a single wakeup.
+ *
+ * \code
+ * EventLoop renderLoop;
+ * EventBus::AddHandler<PlayerMoveEvent>(renderer, HandlerOptions().deliverOn(&renderLoop));
+ *
+ * // On the render thread, once per frame
+ * renderLoop.runPending();
+ * \endcode
+ */
+class EventLoop : public Executor {
+public:
+	EventLoop() :
+		inbox(nullptr),
+		stopping(false)
+	{ }
+
+
+	/**
+	 * \brief Discards the tasks that haven't been run
+	 */
+	virtual ~EventLoop() {
+		Task* task = inbox.exchange(nullptr, std::memory_order_acquire);
+
+		while (task != nullptr) {
+			Task* next = task->next;
+			task->handler(task, false);
+			task = next;
+		}
+	}
+
+
+	/**
+	 * \brief Schedules a function to be run on the loop's thread
+	 *
+	 * @param function The function to call
+	 * @param argument The argument passed to the function
+	 */
+	virtual void post(Function function, void * argument) override {
+		post(*new FunctionTask(function, argument));
+	}
+
+
+	/**
+	 * \brief Schedules a task to be run on the loop's thread, without allocating
+	 *
+	 * @param task The task to run
+	 */
+	virtual void post(Task & task) override {
+		Task* head = inbox.load(std::memory_order_relaxed);
+
+		do {
+			task.next = head;
+		} while (!inbox.compare_exchange_weak(head, &task, std::memory_order_release, std::memory_order_relaxed));
+
+		// Only the first task of a batch needs to wake the owner. Taking the mutex makes sure the
+		// owner is either already waiting or will see the task when it checks the inbox.
+		if (head == nullptr) {
+			std::lock_guard<std::mutex> lock(mutex);
+			wakeup.notify_one();
+		}
+	}
+
+
+	/**
+	 * \brief Runs every task that has been posted so far, must be called on the owning thread
+	 *
+	 * @return The number of tasks run
+	 */
+	std::size_t runPending() {
+		Task* task = inbox.exchange(nullptr, std::memory_order_acquire);
+
+		// The inbox is a stack, reverse it so tasks run in the order they were posted
+		Task* ordered = nullptr;
+
+		while (task != nullptr) {
+			Task* next = task->next;
+			task->next = ordered;
+			ordered = task;
+			task = next;
+		}
+
+		std::size_t count = 0;
+
+		while (ordered != nullptr) {
+			Task* next = ordered->next;
+			ordered->handler(ordered, true);
+			ordered = next;
+			++count;
+		}
+
+		return count;
+	}
+
+
+	/**
+	 * \brief Runs tasks on the calling thread until stop is called
+	 */
+	void run() {
+		for (;;) {
+			runPending();
+
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeup.wait(lock, [this] { return inbox.load(std::memory_order_relaxed) != nullptr || stopping; });
+
+			if (stopping) {
+				stopping = false;
+				return;
+			}
+		}
+	}
+
+
+	/**
+	 * \brief Makes run return once it has finished the tasks it is running
+	 */
+	void stop() {
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		wakeup.notify_one();
+	}
+
+private:
+	std::atomic<Task*> inbox;
+
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	bool stopping;
+
+	EventLoop(const EventLoop &) = delete;
+	EventLoop & operator=(const EventLoop &) = delete;
+};
+
+#endif /* _SRC_EVENT_EVENT_LOOP_HPP_ */
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_EXECUTOR_HPP_
+#define _SRC_EVENT_EXECUTOR_HPP_
+
+/**
+ * \brief Interface for objects that run work on a particular thread or loop
+ *
+ * Work is posted as a plain function pointer and argument so that posting doesn't need to
+ * allocate a closure. The executor decides when and on which thread the function is called.
+ */
+class Executor {
+public:
+	typedef void (*Function)(void *);
+
+
+	/**
+	 * \brief Unit of work that carries its own link, so executors can queue it without allocating
+	 *
+	 * The handler is called exactly once, with run set to false if the executor is destroyed before
+	 * running the task. The handler owns the task and is responsible for freeing it.
+	 */
+	struct Task {
+		typedef void (*Handler)(Task *, bool run);
+
+		Task(Handler handler) :
+			handler(handler),
+			next(nullptr)
+		{ }
+
+		Handler handler;
+		Task* next;
+	};
+
+
+	/**
+	 * \brief Empty virtual destructor
+	 */
+	virtual ~Executor() { }
+
+
+	/**
+	 * \brief Schedules a function to be run by the executor
+	 *
+	 * @param function The function to call
+	 * @param argument The argument passed to the function
+	 */
+	virtual void post(Function function, void * argument) = 0;
+
+
+	/**
+	 * \brief Schedules a task to be run by the executor
+	 *
+	 * Executors with an intrusive queue should override this, the default posts a function that
+	 * runs the task.
+	 *
+	 * @param task The task to run
+	 */
+	virtual void post(Task & task) {
+		post(&RunTask, &task);
+	}
+
+protected:
+	/**
+	 * \brief Task wrapping a plain function posted through the Executor interface
+	 */
+	struct FunctionTask : public Task {
+		FunctionTask(Function function, void * argument) :
+			Task(&Run),
+			function(function),
+			argument(argument)
+		{ }
+
+		static void Run(Task * task, bool run) {
+			FunctionTask* self = static_cast<FunctionTask*>(task);
+			Function function = self->function;
+			void* argument = self->argument;
+			delete self;
+
+			if (run) {
+				function(argument);
+			}
+		}
+
+		Function function;
+		void* argument;
+	};
+
+private:
+	static void RunTask(void * task) {
+		static_cast<Task*>(task)->handler(static_cast<Task*>(task), true);
+	}
+};
+
+#endif /* _SRC_EVENT_EXECUTOR_HPP_ */
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_HANDLER_OPTIONS_HPP_
+#define _SRC_EVENT_HANDLER_OPTIONS_HPP_
+
+#include "ResourceAccess.hpp"
+
+#include <cstddef>
+#include <string>
+
+class Executor;
+
+/**
+ * \brief Optional settings for an event handler registration
+ *
+ * The setters return the options object so they can be chained when registering a handler.
+ *
+ * \code
+ * EventBus::AddHandler<PlayerMoveEvent>(listener, player, HandlerOptions().replaySticky());
+ * \endcode
+ */
+class HandlerOptions {
+public:
+	/**
+	 * \brief Default constructor, a handler registered with default options behaves like AddHandler
+	 */
+	HandlerOptions() :
+		replay(false),
+		sampleEvery(1),
+		rate(0),
+		burst(1),
+		perSender(false),
+		executor(nullptr),
+		backlog(0)
+	{ }
+
+
+	/**
+	 * \brief Sets whether cached sticky events are replayed to the handler when it is registered
+	 *
+	 * @param replay true to replay the cached events
+	 * @return This options object
+	 */
+	HandlerOptions & replaySticky(bool replay = true) {
+		this->replay = replay;
+		return *this;
+	}
+
+
+	/**
+	 * \brief Gets whether cached sticky events are replayed to the handler when it is registered
+	 *
+	 * @return true if the cached events are replayed
+	 */
+	bool getReplaySticky() const {
+		return replay;
+	}
+
+
+	/**
+	 * \brief Only delivers every Nth event to the handler
+	 *
+	 * @param every The sampling ratio, 1 delivers every event
+	 * @return This options object
+	 */
+	HandlerOptions & sample(unsigned int every) {
+		sampleEvery = every;
+		return *this;
+	}
+
+
+	/**
+	 * \brief Gets the sampling ratio
+	 *
+	 * @return The sampling ratio
+	 */
+	unsigned int getSampleEvery() const {
+		return sampleEvery;
+	}
+
+
+	/**
+	 * \brief Limits the rate of events delivered to the handler with a token bucket
+	 *
+	 * Events over the limit are skipped for this handler only. Per-sender buckets are dropped once
+	 * they have refilled, and EventBus::ClearSender drops a sender's buckets right away.
+	 *
+	 * @param perSecond The sustained number of events per second, 0 disables the limit
+	 * @param burst The number of events that can be delivered back to back
+	 * @param perSender true to give every sender its own bucket
+	 * @return This options object
+	 */
+	HandlerOptions & rateLimit(double perSecond, double burst = 1, bool perSender = false) {
+		this->rate = perSecond;
+		this->burst = burst;
+		this->perSender = perSender;
+		return *this;
+	}
+
+
+	/**
+	 * \brief Gets the rate limit
+	 *
+	 * @return The events per second, or 0 if there is no limit
+	 */
+	double getRateLimit() const {
+		return rate;
+	}
+
+
+	/**
+	 * \brief Gets the rate limit burst size
+	 *
+	 * @return The burst size
+	 */
+	double getRateBurst() const {
+		return burst;
+	}
+
+
+	/**
+	 * \brief Gets whether the rate limit applies to each sender separately
+	 *
+	 * @return true if every sender has its own bucket
+	 */
+	bool getRatePerSender() const {
+		return perSender;
+	}
+
+
+	/**
+	 * \brief Delivers events to the handler through an executor instead of from FireEvent
+	 *
+	 * FireEvent posts a copy of each event to the executor, so the handler runs on the executor's
+	 * thread. The event type must be copy constructible, otherwise AddHandler throws
+	 * std::invalid_argument.
+	 *
+	 * Each copy is a separate allocation. Without a backlog the copies are posted however far the
+	 * handler falls behind, so a handler that can't keep up grows the executor's queue without
+	 * limit. With a backlog, new events are dropped while that many copies are waiting, and the
+	 * drops are counted by EventBus::getDroppedDeliveries. Use a QueuedEventHandler for the other
+	 * overflow policies.
+	 *
+	 * Removing the handler while the executor is running it waits for that call to return, so
+	 * the handler can be destroyed once removeHandler returns.
+	 *
+	 * @param executor The executor that owns the handler, or nullptr to call it from FireEvent
+	 * @param backlog The maximum number of copies waiting for the handler, or 0 for no limit
+	 * @return This options object
+	 */
+	HandlerOptions & deliverOn(Executor * executor, std::size_t backlog = 0) {
+		this->executor = executor;
+		this->backlog = backlog;
+		return *this;
+	}
+
+
+	/**
+	 * \brief Gets the executor events are delivered through
+	 *
+	 * @return The executor, or nullptr if the handler is called from FireEvent
+	 */
+	Executor* getExecutor() const {
+		return executor;
+	}
+
+
+	/**
+	 * \brief Gets the maximum number of copies waiting on the executor
+	 *
+	 * @return The backlog, or 0 if it isn't limited
+	 */
+	std::size_t getBacklog() const {
+		return backlog;
+	}
+
+
+	/**
+	 * \brief Declares a resource the handler reads, such as "player positions"
+	 *
+	 * Handlers that declare their resources can be run in parallel with the other handlers of an
+	 * event when the EventBus has workers. Handlers that don't declare anything always run alone.
+	 *
+	 * @param resource The resource name
+	 * @return This options object
+	 */
+	HandlerOptions & reads(const std::string & resource) {
+		access.read(resource);
+		return *this;
+	}
+
+
+	/**
+	 * \brief Declares a resource the handler writes, such as "chat log"
+	 *
+	 * @param resource The resource name
+	 * @return This options object
+	 */
+	HandlerOptions & writes(const std::string & resource) {
+		access.write(resource);
+		return *this;
+	}
+
+
+	/**
+	 * \brief Declares that the handler may cancel or change the event
+	 *
+	 * Every handler that declares its resources reads the event, so a handler that cancels it
+	 * keeps its registration order with all of them when they are run in parallel.
+	 *
+	 * @return This options object
+	 */
+	HandlerOptions & cancels() {
+		access.write(ResourceAccess::EventResource());
+		return *this;
+	}
+
+
+	/**
+	 * \brief Gets the declared resources
+	 *
+	 * @return The resources the handler reads and writes
+	 */
+	const ResourceAccess & getAccess() const {
+		return access;
+	}
+
+private:
+	bool replay;
+	unsigned int sampleEvery;
+	double rate;
+	double burst;
+	bool perSender;
+	Executor* executor;
+	std::size_t backlog;
+	ResourceAccess access;
+};
+
+#endif /* _SRC_EVENT_HANDLER_OPTIONS_HPP_ */
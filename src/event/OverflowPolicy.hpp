@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_OVERFLOW_POLICY_HPP_
+#define _SRC_EVENT_OVERFLOW_POLICY_HPP_
+
+/**
+ * \brief What a bounded event queue does with a new event when it is full
+ */
+enum class OverflowPolicy {
+	// Wait in FireEvent until the delivery thread makes room, needs start() to have been called
+	Block,
+
+	// Discard the oldest queued event to make room
+	DropOldest,
+
+	// Discard the new event
+	DropNewest,
+
+	// Replace the queued event from the same sender, or discard the oldest if there isn't one
+	Conflate
+};
+
+#endif /* _SRC_EVENT_OVERFLOW_POLICY_HPP_ */
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_PARALLEL_SCHEDULE_HPP_
+#define _SRC_EVENT_PARALLEL_SCHEDULE_HPP_
+
+#include "Executor.hpp"
+#include "ResourceAccess.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * \brief Dependency graph of a list of handlers, used to run them in parallel in a deterministic way
+ *
+ * Every handler depends on the earlier handlers it conflicts with, so conflicting handlers always
+ * run in list order and the result is the same as running the list one handler at a time. A
+ * handler that hasn't declared its access conflicts with every other handler.
+ */
+class ParallelSchedule {
+public:
+	typedef void (*Function)(void * context, std::size_t node);
+
+
+	/**
+	 * \brief Builds the dependency graph
+	 *
+	 * @param access The access of each handler in list order, nullptr if a handler hasn't declared any
+	 */
+	ParallelSchedule(const std::vector<const ResourceAccess*> & access) :
+		dependencies(access.size(), 0),
+		firstSuccessor(access.size() + 1, 0) {
+		std::vector<std::vector<std::size_t>> edges(access.size());
+
+		for (std::size_t i = 0; i < access.size(); ++i) {
+			for (std::size_t j = 0; j < i; ++j) {
+				if (access[i] == nullptr || access[j] == nullptr || access[i]->conflicts(*access[j])) {
+					edges[j].push_back(i);
+					++dependencies[i];
+				}
+			}
+		}
+
+		// Flatten the successor lists into a single array
+		for (std::size_t i = 0; i < edges.size(); ++i) {
+			firstSuccessor[i] = successors.size();
+			successors.insert(successors.end(), edges[i].begin(), edges[i].end());
+		}
+
+		firstSuccessor[edges.size()] = successors.size();
+	}
+
+
+	/**
+	 * \brief Gets the number of handlers in the graph
+	 *
+	 * @return The number of handlers
+	 */
+	std::size_t size() const {
+		return dependencies.size();
+	}
+
+
+	/**
+	 * \brief Runs every handler once its dependencies have finished
+	 *
+	 * The calling thread runs handlers itself and posts up to helpers tasks to the executor to run
+	 * the others. It returns once every handler has run, even if the executor never gets to the
+	 * tasks. If a handler throws, the handlers that depend on it are skipped and the first exception
+	 * is rethrown once the handlers that are still running have finished.
+	 *
+	 * @param workers The executor that runs the helper tasks
+	 * @param helpers The maximum number of helper tasks posted at once
+	 * @param function Called to run a handler
+	 * @param context The argument passed to function
+	 */
+	void run(Executor & workers, unsigned int helpers, Function function, void * context) const {
+		if (size() == 0) {
+			return;
+		}
+
+		std::shared_ptr<State> state = std::make_shared<State>(*this, workers, helpers, function, context);
+
+		std::unique_lock<std::mutex> lock(state->mutex);
+
+		for (std::size_t i = 0; i < size(); ++i) {
+			if (dependencies[i] == 0) {
+				state->ready.push_back(i);
+			}
+		}
+
+		state->spawn(lock, state);
+
+		for (;;) {
+			if (state->step(lock, state)) {
+				continue;
+			}
+
+			if (state->finished()) {
+				break;
+			}
+
+			state->wakeup.wait(lock);
+		}
+
+		if (state->error) {
+			std::rethrow_exception(state->error);
+		}
+	}
+
+private:
+	/**
+	 * \brief Progress of a single run, shared with the helper tasks
+	 *
+	 * Helpers that start after the run has returned find nothing to do, so the caller never waits
+	 * for the executor.
+	 */
+	struct State {
+		State(const ParallelSchedule & schedule, Executor & workers, unsigned int helpers, Function function, void * context) :
+			schedule(schedule),
+			workers(workers),
+			function(function),
+			context(context),
+			pending(schedule.dependencies),
+			remaining(schedule.size()),
+			running(0),
+			helpers(0),
+			maxHelpers(helpers),
+			failed(false)
+		{ }
+
+
+		/**
+		 * \brief Runs one ready handler, called with the lock held
+		 *
+		 * @return false if there was nothing to run
+		 */
+		bool step(std::unique_lock<std::mutex> & lock, const std::shared_ptr<State> & self) {
+			if (ready.empty() || failed) {
+				return false;
+			}
+
+			const std::size_t node = ready.back();
+			ready.pop_back();
+			++running;
+			lock.unlock();
+
+			bool ok = true;
+
+			try {
+				function(context, node);
+			} catch (...) {
+				ok = false;
+				lock.lock();
+
+				if (!failed) {
+					failed = true;
+					error = std::current_exception();
+				}
+			}
+
+			if (ok) {
+				lock.lock();
+
+				for (std::size_t i = schedule.firstSuccessor[node]; i < schedule.firstSuccessor[node + 1]; ++i) {
+					if (--pending[schedule.successors[i]] == 0) {
+						ready.push_back(schedule.successors[i]);
+					}
+				}
+
+				--remaining;
+			}
+
+			--running;
+			spawn(lock, self);
+			wakeup.notify_one();
+
+			return true;
+		}
+
+
+		/**
+		 * \brief Posts helpers for the ready handlers the current thread won't get to, called with the lock held
+		 */
+		void spawn(std::unique_lock<std::mutex> & lock, const std::shared_ptr<State> & self) {
+			if (failed || ready.size() < 2 || helpers >= maxHelpers) {
+				return;
+			}
+
+			std::size_t count = ready.size() - 1;
+
+			if (count > maxHelpers - helpers) {
+				count = maxHelpers - helpers;
+			}
+
+			helpers += static_cast<unsigned int>(count);
+			lock.unlock();
+
+			for (std::size_t i = 0; i < count; ++i) {
+				workers.post(*new Helper(self));
+			}
+
+			lock.lock();
+		}
+
+
+		/**
+		 * \brief Gets whether the run is over, called with the lock held
+		 */
+		bool finished() const {
+			return remaining == 0 || (failed && running == 0);
+		}
+
+		const ParallelSchedule & schedule;
+		Executor & workers;
+		const Function function;
+		void* const context;
+
+		std::mutex mutex;
+		std::condition_variable wakeup;
+		std::vector<unsigned int> pending;
+		std::vector<std::size_t> ready;
+		std::size_t remaining;
+		unsigned int running;
+		unsigned int helpers;
+		const unsigned int maxHelpers;
+		bool failed;
+		std::exception_ptr error;
+	};
+
+
+	/**
+	 * \brief Task that runs ready handlers on a worker until there are none left
+	 */
+	struct Helper : public Executor::Task {
+		Helper(const std::shared_ptr<State> & state) :
+			Task(&Run),
+			state(state)
+		{ }
+
+		static void Run(Task * task, bool run) {
+			std::unique_ptr<Helper> helper(static_cast<Helper*>(task));
+			State & state = *helper->state;
+			std::unique_lock<std::mutex> lock(state.mutex);
+
+			if (run) {
+				while (state.step(lock, helper->state)) {
+				}
+			}
+
+			--state.helpers;
+		}
+
+		const std::shared_ptr<State> state;
+	};
+
+	std::vector<unsigned int> dependencies;
+	std::vector<std::size_t> firstSuccessor;
+	std::vector<std::size_t> successors;
+};
+
+#endif /* _SRC_EVENT_PARALLEL_SCHEDULE_HPP_ */
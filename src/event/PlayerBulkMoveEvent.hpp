@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_PLAYER_BULK_MOVE_EVENT_HPP_
+#define _SRC_EVENT_PLAYER_BULK_MOVE_EVENT_HPP_
+
+#include "Event.hpp"
+#include "Player.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * \brief Example event carrying a whole tick of player movement in struct-of-arrays form
+ *
+ * Instead of one PlayerMoveEvent per player, the moves are stored in parallel arrays so a handler
+ * can validate all of them with a vectorized kernel and a single virtual call. Handlers reject
+ * individual moves by setting bits in the cancel mask, and canceling the event itself rejects the
+ * whole batch.
+ *
+ * This is not part of the core functionality and can be modified or deleted as desired
+ */
+class PlayerBulkMoveEvent : public Event
+{
+public:
+	PlayerBulkMoveEvent(Object & sender, std::size_t capacity = 0) :
+	Event(sender) {
+		players.reserve(capacity);
+		oldX.reserve(capacity);
+		oldY.reserve(capacity);
+		oldZ.reserve(capacity);
+		newX.reserve(capacity);
+		newY.reserve(capacity);
+		newZ.reserve(capacity);
+		cancelMask.reserve((capacity + 63) / 64);
+	}
+
+	virtual ~PlayerBulkMoveEvent() { }
+
+
+	/**
+	 * \brief Adds a move from the player's current position to a new one
+	 *
+	 * @param player The moving player
+	 * @param x The new X position
+	 * @param y The new Y position
+	 * @param z The new Z position
+	 */
+	void add(Player & player, int x, int y, int z) {
+		players.push_back(&player);
+		oldX.push_back(player.getX());
+		oldY.push_back(player.getY());
+		oldZ.push_back(player.getZ());
+		newX.push_back(x);
+		newY.push_back(y);
+		newZ.push_back(z);
+
+		if (players.size() > cancelMask.size() * 64) {
+			cancelMask.push_back(0);
+		}
+	}
+
+
+	std::size_t size() {
+		return players.size();
+	}
+
+	Player & getPlayer(std::size_t i) {
+		return *players[i];
+	}
+
+	const int* getOldX() {
+		return oldX.data();
+	}
+
+	const int* getOldY() {
+		return oldY.data();
+	}
+
+	const int* getOldZ() {
+		return oldZ.data();
+	}
+
+	const int* getNewX() {
+		return newX.data();
+	}
+
+	const int* getNewY() {
+		return newY.data();
+	}
+
+	const int* getNewZ() {
+		return newZ.data();
+	}
+
+
+	/**
+	 * \brief Gets the cancel mask, bit i of word i / 64 is set when move i is canceled
+	 *
+	 * @return The mask words
+	 */
+	std::uint64_t* getCancelMask() {
+		return cancelMask.data();
+	}
+
+
+	/**
+	 * \brief Cancels a single move
+	 *
+	 * @param i The move index
+	 */
+	void cancel(std::size_t i) {
+		cancelMask[i / 64] |= std::uint64_t(1) << (i % 64);
+	}
+
+
+	/**
+	 * \brief Gets whether a single move has been canceled
+	 *
+	 * @param i The move index
+	 * @return true if the move is canceled
+	 */
+	bool isCanceled(std::size_t i) {
+		return getCanceled() || (cancelMask[i / 64] >> (i % 64)) & 1;
+	}
+
+
+	/**
+	 * \brief Cancels every move whose new X or Z position is outside of a square border
+	 *
+	 * @param border The largest allowed absolute X and Z position
+	 */
+	void cancelOutside(int border) {
+		const std::size_t count = players.size();
+		const int* x = newX.data();
+		const int* z = newZ.data();
+		std::uint64_t* mask = cancelMask.data();
+		std::size_t i = 0;
+
+#if defined(__AVX2__)
+		const __m256i high = _mm256_set1_epi32(border);
+		const __m256i low = _mm256_set1_epi32(-border);
+
+		for (; i + 8 <= count; i += 8) {
+			const __m256i vx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+			const __m256i vz = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(z + i));
+
+			const __m256i outside = _mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpgt_epi32(vx, high), _mm256_cmpgt_epi32(low, vx)),
+				_mm256_or_si256(_mm256_cmpgt_epi32(vz, high), _mm256_cmpgt_epi32(low, vz)));
+
+			const std::uint64_t bits = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(outside)));
+			mask[i / 64] |= bits << (i % 64);
+		}
+#elif defined(__SSE2__)
+		const __m128i high = _mm_set1_epi32(border);
+		const __m128i low = _mm_set1_epi32(-border);
+
+		for (; i + 4 <= count; i += 4) {
+			const __m128i vx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+			const __m128i vz = _mm_loadu_si128(reinterpret_cast<const __m128i*>(z + i));
+
+			const __m128i outside = _mm_or_si128(
+				_mm_or_si128(_mm_cmpgt_epi32(vx, high), _mm_cmpgt_epi32(low, vx)),
+				_mm_or_si128(_mm_cmpgt_epi32(vz, high), _mm_cmpgt_epi32(low, vz)));
+
+			const std::uint64_t bits = static_cast<unsigned int>(_mm_movemask_ps(_mm_castsi128_ps(outside)));
+			mask[i / 64] |= bits << (i % 64);
+		}
+#endif
+
+		// Scalar tail, and the whole loop when no vector instructions are available
+		for (; i < count; ++i) {
+			if (x[i] > border || x[i] < -border || z[i] > border || z[i] < -border) {
+				mask[i / 64] |= std::uint64_t(1) << (i % 64);
+			}
+		}
+	}
+
+
+	/**
+	 * \brief Moves every player whose move wasn't canceled to the new position
+	 *
+	 * @return The number of players moved
+	 */
+	std::size_t apply() {
+		std::size_t moved = 0;
+
+		for (std::size_t i = 0; i < players.size(); ++i) {
+			if (!isCanceled(i)) {
+				players[i]->setPosition(newX[i], newY[i], newZ[i]);
+				++moved;
+			}
+		}
+
+		return moved;
+	}
+
+private:
+	std::vector<Player*> players;
+
+	std::vector<int> oldX;
+	std::vector<int> oldY;
+	std::vector<int> oldZ;
+
+	std::vector<int> newX;
+	std::vector<int> newY;
+	std::vector<int> newZ;
+
+	std::vector<std::uint64_t> cancelMask;
+
+};
+
+#endif /* _SRC_EVENT_PLAYER_BULK_MOVE_EVENT_HPP_ */
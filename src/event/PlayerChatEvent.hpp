@@ -25,13 +25,20 @@
 
 #include "Event.hpp"
 #include "Player.hpp"
+#include "SharedString.hpp"
 
-#include <string>
-
+/**
+ * \brief Example event class to showcase some of the features of the EventBus
+ *
+ * The message is held in a SharedString, so copies of the event can be queued or cached
+ * without copying the message text or referencing the caller's string.
+ *
+ * This is not part of the core functionality and can be modified or deleted as desired
+ */
 class PlayerChatEvent : public Event
 {
 public:
-	PlayerChatEvent(Object & sender, Player & player, std::string const & msg) :
+	PlayerChatEvent(Object & sender, Player & player, SharedString const & msg) :
 	Event(sender),
 	player(player),
 	msg(msg) {
@@ -43,13 +50,13 @@ public:
 		return player;
 	}
 
-	std::string const & getMessage() {
+	SharedString const & getMessage() {
 		return msg;
 	}
 
 private:
 	Player & player;
-	std::string const & msg;
+	SharedString msg;
 
 };
 
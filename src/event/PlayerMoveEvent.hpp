@@ -31,6 +31,12 @@
 /**
  * \brief Example event class to showcase some of the features of the EventBus
  *
+ * The event can be fired after the player has already been moved, in which case it only carries
+ * the old position and the new position is the player's current one. It can also be fired as the
+ * proposal phase of a two-phase move, before the player is moved, by passing both positions. Handlers
+ * can then cancel the move without the player's state ever changing, and PlayerMovedEvent is fired
+ * once an accepted move has been applied.
+ *
  * This is not part of the core functionality and can be modified or deleted as desired
  */
 class PlayerMoveEvent : public Event
@@ -41,7 +47,22 @@ public:
 	player(player),
 	oldX(oldX),
 	oldY(oldY),
-	oldZ(oldZ) {
+	oldZ(oldZ),
+	newX(player.getX()),
+	newY(player.getY()),
+	newZ(player.getZ()) {
+	}
+
+
+	PlayerMoveEvent(Object & sender, Player & player, int oldX, int oldY, int oldZ, int newX, int newY, int newZ) :
+	Event(sender),
+	player(player),
+	oldX(oldX),
+	oldY(oldY),
+	oldZ(oldZ),
+	newX(newX),
+	newY(newY),
+	newZ(newZ) {
 	}
 
 	virtual ~PlayerMoveEvent() { }
@@ -62,6 +83,18 @@ public:
 		return oldZ;
 	}
 
+	int getNewX() {
+		return newX;
+	}
+
+	int getNewY() {
+		return newY;
+	}
+
+	int getNewZ() {
+		return newZ;
+	}
+
 private:
 	Player & player;
 
@@ -69,6 +102,10 @@ private:
 	int oldY;
 	int oldZ;
 
+	int newX;
+	int newY;
+	int newZ;
+
 };
 
 #endif /* _SRC_EVENT_PLAYER_MOVE_EVENT_HPP_ */
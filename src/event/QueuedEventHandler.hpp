@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_QUEUED_EVENT_HANDLER_HPP_
+#define _SRC_EVENT_QUEUED_EVENT_HANDLER_HPP_
+
+#include "Object.hpp"
+#include "EventHandler.hpp"
+#include "OverflowPolicy.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief Snapshot of the delivery counters of a QueuedEventHandler
+ */
+struct QueueStats {
+	// Events currently waiting in the queue
+	std::size_t size;
+
+	// Largest number of events that have been waiting at once
+	std::size_t peakSize;
+
+	unsigned long long enqueued;
+	unsigned long long delivered;
+	unsigned long long dropped;
+	unsigned long long conflated;
+
+	// Longest time an event has waited between being fired and being delivered
+	std::chrono::steady_clock::duration maxLag;
+};
+
+
+/**
+ * \brief Event handler adapter that delivers events asynchronously through a bounded queue
+ *
+ * The adapter is registered with the EventBus in place of the target handler. FireEvent only
+ * copies the event into the adapter's own queue, and the target handler is called later from
+ * drain() or from the adapter's delivery thread. Since every subscriber has its own queue and
+ * overflow policy, a slow handler only falls behind itself instead of stalling the producer and
+ * the other handlers.
+ *
+ * T must be copy constructible, and the senders and any data referenced by queued events have to
+ * stay alive until the events are delivered.
+ *
+ * The Block policy can only wait for the delivery thread, since a producer blocked in FireEvent
+ * can't call drain itself. If the queue is full and the delivery thread isn't running, onEvent
+ * throws std::logic_error instead of waiting forever. Producers still blocked when the thread is
+ * stopped give up and their events are counted as dropped.
+ *
+ * \code
+ * QueuedEventHandler<PlayerChatEvent> queued(databaseWriter, 1024, OverflowPolicy::DropOldest);
+ * queued.start();
+ * EventBus::AddHandler<PlayerChatEvent>(queued);
+ * \endcode
+ */
+template <class T>
+class QueuedEventHandler : public EventHandler<T>
+{
+public:
+	/**
+	 * \brief Creates a queued adapter for a handler
+	 *
+	 * @param target The handler the queued events are delivered to
+	 * @param capacity The maximum number of queued events
+	 * @param policy What to do with new events when the queue is full
+	 */
+	QueuedEventHandler(EventHandler<T> & target, std::size_t capacity, OverflowPolicy policy) :
+		target(target),
+		policy(policy),
+		slots(capacity > 0 ? capacity : 1),
+		head(0),
+		count(0),
+		consumerWaiting(false),
+		blockedProducers(0),
+		running(false),
+		stopping(false) {
+		stats.size = 0;
+		stats.peakSize = 0;
+		stats.enqueued = 0;
+		stats.delivered = 0;
+		stats.dropped = 0;
+		stats.conflated = 0;
+		stats.maxLag = std::chrono::steady_clock::duration::zero();
+
+		if (policy == OverflowPolicy::Conflate) {
+			queuedBySender.reserve(slots.size());
+		}
+	}
+
+
+	/**
+	 * \brief Stops the delivery thread and discards any events that are still queued
+	 */
+	virtual ~QueuedEventHandler() {
+		stop();
+
+		// Blocked producers were woken by stop, wait for them to let go of the adapter
+		std::unique_lock<std::mutex> lock(mutex);
+		notFull.wait(lock, [this] { return blockedProducers == 0; });
+
+		while (count > 0) {
+			pop();
+		}
+	}
+
+
+	/**
+	 * \brief Queues a copy of the event, called by the EventBus
+	 *
+	 * @param e The fired event
+	 */
+	virtual void onEvent(T & e) override {
+		// Copy outside of the lock to keep the consumer's critical section short
+		T copy(e);
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		std::unique_lock<std::mutex> lock(mutex);
+
+		if (policy == OverflowPolicy::Conflate) {
+			typename SenderMap::iterator it = queuedBySender.find(&e.getSender());
+
+			if (it != queuedBySender.end()) {
+				Slot & slot = slots[it->second];
+				slot.event->~T();
+				slot.event = new (&slot.storage) T(std::move(copy));
+				++stats.conflated;
+				return;
+			}
+		}
+
+		if (count == slots.size()) {
+			switch (policy) {
+			case OverflowPolicy::Block:
+				if (!running || stopping) {
+					throw std::logic_error("QueuedEventHandler: the Block policy needs the delivery thread, call start() first");
+				}
+
+				++blockedProducers;
+				notFull.wait(lock, [this] { return count < slots.size() || stopping; });
+				--blockedProducers;
+
+				if (stopping) {
+					// Let the destructor know once the last blocked producer is done
+					notFull.notify_all();
+				}
+
+				if (count == slots.size()) {
+					// The delivery thread was stopped before it made room
+					++stats.dropped;
+					return;
+				}
+
+				break;
+
+			case OverflowPolicy::DropNewest:
+				++stats.dropped;
+				return;
+
+			case OverflowPolicy::DropOldest:
+			case OverflowPolicy::Conflate:
+				pop();
+				++stats.dropped;
+				break;
+			}
+		}
+
+		const std::size_t index = (head + count) % slots.size();
+		Slot & slot = slots[index];
+		slot.event = new (&slot.storage) T(std::move(copy));
+		slot.queued = now;
+		++count;
+
+		if (policy == OverflowPolicy::Conflate) {
+			queuedBySender[&slot.event->getSender()] = index;
+		}
+
+		++stats.enqueued;
+		if (count > stats.peakSize) {
+			stats.peakSize = count;
+		}
+
+		if (consumerWaiting) {
+			notEmpty.notify_one();
+		}
+	}
+
+
+	/**
+	 * \brief Delivers queued events to the target handler on the calling thread
+	 *
+	 * @param max The maximum number of events to deliver
+	 * @return The number of events delivered
+	 */
+	std::size_t drain(std::size_t max = std::numeric_limits<std::size_t>::max()) {
+		std::size_t delivered = 0;
+
+		while (delivered < max) {
+			std::unique_lock<std::mutex> lock(mutex);
+
+			if (count == 0) {
+				break;
+			}
+
+			Slot & slot = slots[head];
+			T event(std::move(*slot.event));
+
+			const std::chrono::steady_clock::duration lag = std::chrono::steady_clock::now() - slot.queued;
+			if (lag > stats.maxLag) {
+				stats.maxLag = lag;
+			}
+
+			pop();
+			++stats.delivered;
+			notFull.notify_one();
+
+			lock.unlock();
+
+			target.onEvent(event);
+			++delivered;
+		}
+
+		return delivered;
+	}
+
+
+	/**
+	 * \brief Starts a dedicated thread that delivers events as soon as they are queued
+	 */
+	void start() {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (running) {
+			return;
+		}
+
+		running = true;
+		stopping = false;
+		worker = std::thread(&QueuedEventHandler::run, this);
+	}
+
+
+	/**
+	 * \brief Stops the delivery thread, events that haven't been delivered yet stay queued
+	 */
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (!running) {
+				return;
+			}
+
+			stopping = true;
+			notEmpty.notify_one();
+
+			// Producers blocked on a full queue can't rely on the delivery thread any more
+			notFull.notify_all();
+		}
+
+		worker.join();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+
+
+	/**
+	 * \brief Gets the delivery counters
+	 *
+	 * @return A snapshot of the counters
+	 */
+	QueueStats getStats() {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		QueueStats snapshot = stats;
+		snapshot.size = count;
+		return snapshot;
+	}
+
+private:
+	/**
+	 * \brief Queue slot with uninitialized storage for one event
+	 *
+	 * Events can have reference members, so the event is only ever reached through the pointer
+	 * returned when it was constructed in the storage.
+	 */
+	struct Slot {
+		Slot() : event(nullptr) { }
+
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+		T* event;
+		std::chrono::steady_clock::time_point queued;
+	};
+
+	typedef std::unordered_map<const Object*, std::size_t> SenderMap;
+
+	EventHandler<T> & target;
+	const OverflowPolicy policy;
+
+	std::vector<Slot> slots;
+	std::size_t head;
+	std::size_t count;
+
+	// Slot of the queued event from each sender, only kept for the Conflate policy
+	SenderMap queuedBySender;
+
+	std::mutex mutex;
+	std::condition_variable notEmpty;
+	std::condition_variable notFull;
+	bool consumerWaiting;
+	unsigned int blockedProducers;
+
+	std::thread worker;
+	bool running;
+	bool stopping;
+
+	QueueStats stats;
+
+
+	/**
+	 * \brief Destroys the oldest queued event, the mutex must be held
+	 */
+	void pop() {
+		Slot & slot = slots[head];
+
+		if (policy == OverflowPolicy::Conflate) {
+			queuedBySender.erase(&slot.event->getSender());
+		}
+
+		slot.event->~T();
+		slot.event = nullptr;
+		head = (head + 1) % slots.size();
+		--count;
+	}
+
+
+	/**
+	 * \brief Body of the delivery thread
+	 */
+	void run() {
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+
+				consumerWaiting = true;
+				notEmpty.wait(lock, [this] { return count > 0 || stopping; });
+				consumerWaiting = false;
+
+				if (stopping) {
+					return;
+				}
+			}
+
+			drain();
+		}
+	}
+};
+
+#endif /* _SRC_EVENT_QUEUED_EVENT_HANDLER_HPP_ */
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_RESOURCE_ACCESS_HPP_
+#define _SRC_EVENT_RESOURCE_ACCESS_HPP_
+
+#include "SharedString.hpp"
+#include "StringTable.hpp"
+
+#include <string>
+#include <vector>
+
+/**
+ * \brief The named resources an event handler reads and writes
+ *
+ * Resource names are interned, so two declarations of the same name share a buffer and are
+ * compared by address.
+ */
+class ResourceAccess {
+public:
+	/**
+	 * \brief Gets the name of the resource that stands for the event itself
+	 *
+	 * Any handler may check whether the event was canceled, so every handler that declares its
+	 * access also reads the event. A handler that cancels or changes the event writes it, which
+	 * keeps it in order with every other handler.
+	 *
+	 * @return The resource name
+	 */
+	static const std::string & EventResource() {
+		static const std::string name("event");
+		return name;
+	}
+
+
+	/**
+	 * \brief Declares a resource the handler reads
+	 *
+	 * @param resource The resource name
+	 * @return This access object
+	 */
+	ResourceAccess & read(const std::string & resource) {
+		reads.push_back(StringTable::GetInstance()->intern(resource));
+		return *this;
+	}
+
+
+	/**
+	 * \brief Declares a resource the handler writes
+	 *
+	 * @param resource The resource name
+	 * @return This access object
+	 */
+	ResourceAccess & write(const std::string & resource) {
+		writes.push_back(StringTable::GetInstance()->intern(resource));
+		return *this;
+	}
+
+
+	/**
+	 * \brief Gets whether no resources have been declared
+	 *
+	 * @return true if nothing has been declared
+	 */
+	bool empty() const {
+		return reads.empty() && writes.empty();
+	}
+
+
+	/**
+	 * \brief Gets whether running two handlers at the same time could change the result
+	 *
+	 * Handlers conflict when one of them writes a resource the other reads or writes.
+	 *
+	 * @param other The access of the other handler
+	 * @return true if the handlers must run in order
+	 */
+	bool conflicts(const ResourceAccess & other) const {
+		return Overlaps(writes, other.reads) || Overlaps(writes, other.writes) || Overlaps(reads, other.writes);
+	}
+
+
+	/**
+	 * \brief Gets the resources the handler reads
+	 *
+	 * @return The resource names
+	 */
+	const std::vector<SharedString> & getReads() const {
+		return reads;
+	}
+
+
+	/**
+	 * \brief Gets the resources the handler writes
+	 *
+	 * @return The resource names
+	 */
+	const std::vector<SharedString> & getWrites() const {
+		return writes;
+	}
+
+private:
+	static bool Overlaps(const std::vector<SharedString> & a, const std::vector<SharedString> & b) {
+		for (auto & x : a) {
+			for (auto & y : b) {
+				if (x.sameBuffer(y)) {
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	std::vector<SharedString> reads;
+	std::vector<SharedString> writes;
+};
+
+#endif /* _SRC_EVENT_RESOURCE_ACCESS_HPP_ */
@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_SHARED_STRING_HPP_
+#define _SRC_EVENT_SHARED_STRING_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <string>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+/**
+ * \brief Immutable, reference counted string for event payloads
+ *
+ * The characters are stored in a single shared buffer, so copying a SharedString only bumps a
+ * reference count. This lets events carrying text be queued, cached and fanned out to many
+ * handlers without copying the text itself, and the text stays valid for as long as any copy
+ * of the event exists.
+ */
+class SharedString {
+public:
+	/**
+	 * \brief Creates an empty string
+	 */
+	SharedString() :
+		buffer(nullptr)
+	{ }
+
+
+	/**
+	 * \brief Creates a shared copy of a string
+	 *
+	 * @param str The string to copy
+	 */
+	SharedString(const std::string & str) :
+		buffer(Allocate(str.data(), str.size()))
+	{ }
+
+
+	/**
+	 * \brief Creates a shared copy of a null terminated string
+	 *
+	 * @param str The string to copy
+	 */
+	SharedString(const char * str) :
+		buffer(Allocate(str, std::strlen(str)))
+	{ }
+
+
+	/**
+	 * \brief Creates a shared copy of a character range
+	 *
+	 * @param data The first character
+	 * @param size The number of characters
+	 */
+	SharedString(const char * data, std::size_t size) :
+		buffer(Allocate(data, size))
+	{ }
+
+
+	/**
+	 * \brief Shares the buffer of another string
+	 *
+	 * @param other The string to share
+	 */
+	SharedString(const SharedString & other) noexcept :
+		buffer(other.buffer) {
+		Retain(buffer);
+	}
+
+
+	/**
+	 * \brief Takes over the buffer of another string
+	 *
+	 * @param other The string to move from, it is left empty
+	 */
+	SharedString(SharedString && other) noexcept :
+		buffer(other.buffer) {
+		other.buffer = nullptr;
+	}
+
+
+	/**
+	 * \brief Releases the buffer, it is freed with the last reference
+	 */
+	~SharedString() {
+		Release(buffer);
+	}
+
+
+	SharedString & operator=(const SharedString & other) {
+		Retain(other.buffer);
+		Release(buffer);
+		buffer = other.buffer;
+		return *this;
+	}
+
+
+	SharedString & operator=(SharedString && other) noexcept {
+		if (this != &other) {
+			Release(buffer);
+			buffer = other.buffer;
+			other.buffer = nullptr;
+		}
+
+		return *this;
+	}
+
+
+	/**
+	 * \brief Gets the null terminated characters
+	 *
+	 * @return The characters, valid for as long as this string
+	 */
+	const char * c_str() const {
+		return buffer != nullptr ? buffer->chars : "";
+	}
+
+
+	/**
+	 * \brief Gets the characters
+	 *
+	 * @return The characters, valid for as long as this string
+	 */
+	const char * data() const {
+		return c_str();
+	}
+
+
+	/**
+	 * \brief Gets the number of characters
+	 *
+	 * @return The string length
+	 */
+	std::size_t size() const {
+		return buffer != nullptr ? buffer->size : 0;
+	}
+
+
+	/**
+	 * \brief Gets whether the string is empty
+	 *
+	 * @return true if the string has no characters
+	 */
+	bool empty() const {
+		return size() == 0;
+	}
+
+
+	/**
+	 * \brief Copies the characters into a std::string
+	 *
+	 * @return The copied string
+	 */
+	std::string str() const {
+		return std::string(data(), size());
+	}
+
+
+#if __cplusplus >= 201703L
+	/**
+	 * \brief Views the characters without copying them
+	 *
+	 * @return A view that is valid for as long as this string
+	 */
+	operator std::string_view() const {
+		return std::string_view(data(), size());
+	}
+#endif
+
+
+	/**
+	 * \brief Gets whether two strings share the same buffer
+	 *
+	 * Interned strings with the same characters always share their buffer, so this is a
+	 * constant time equality test for them.
+	 *
+	 * @param other The string to compare with
+	 * @return true if both strings use the same buffer
+	 */
+	bool sameBuffer(const SharedString & other) const {
+		return buffer == other.buffer;
+	}
+
+
+	bool operator==(const SharedString & other) const {
+		return buffer == other.buffer || (size() == other.size() && std::memcmp(data(), other.data(), size()) == 0);
+	}
+
+
+	bool operator!=(const SharedString & other) const {
+		return !(*this == other);
+	}
+
+
+	/**
+	 * \brief Gets the number of strings sharing the buffer
+	 *
+	 * @return The reference count, 0 for an empty string
+	 */
+	unsigned int useCount() const {
+		return buffer != nullptr ? buffer->references.load(std::memory_order_relaxed) : 0;
+	}
+
+private:
+	/**
+	 * \brief Header of the shared buffer, the characters follow it in the same allocation
+	 */
+	struct Buffer {
+		std::atomic<unsigned int> references;
+		std::size_t size;
+		char chars[1];
+	};
+
+	Buffer* buffer;
+
+
+	static Buffer* Allocate(const char * data, std::size_t size) {
+		if (size == 0) {
+			return nullptr;
+		}
+
+		void* memory = ::operator new(offsetof(Buffer, chars) + size + 1);
+		Buffer* buffer = static_cast<Buffer*>(memory);
+
+		new (&buffer->references) std::atomic<unsigned int>(1);
+		buffer->size = size;
+		std::memcpy(buffer->chars, data, size);
+		buffer->chars[size] = '\0';
+
+		return buffer;
+	}
+
+
+	static void Retain(Buffer * buffer) {
+		if (buffer != nullptr) {
+			buffer->references.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+
+	static void Release(Buffer * buffer) {
+		if (buffer != nullptr && buffer->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			buffer->references.~atomic();
+			::operator delete(buffer);
+		}
+	}
+};
+
+#endif /* _SRC_EVENT_SHARED_STRING_HPP_ */
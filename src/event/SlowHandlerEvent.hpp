@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_SLOW_HANDLER_EVENT_HPP_
+#define _SRC_EVENT_SLOW_HANDLER_EVENT_HPP_
+
+#include "Event.hpp"
+#include "HandlerRegistration.hpp"
+
+#include <chrono>
+
+/**
+ * \brief Fired by the EventBus watchdog when a handler keeps exceeding its time budget
+ *
+ * The sender is the EventBus that measured the handler.
+ */
+class SlowHandlerEvent : public Event
+{
+public:
+	SlowHandlerEvent(Object & sender, HandlerRegistration & registration, std::chrono::nanoseconds elapsed, unsigned int overruns, bool demoted) :
+	Event(sender),
+	registration(registration),
+	elapsed(elapsed),
+	overruns(overruns),
+	demoted(demoted) {
+	}
+
+	virtual ~SlowHandlerEvent() { }
+
+
+	/**
+	 * \brief Gets the registration of the slow handler
+	 *
+	 * @return The handler registration
+	 */
+	HandlerRegistration & getRegistration() {
+		return registration;
+	}
+
+
+	/**
+	 * \brief Gets how long the last call to the handler took
+	 *
+	 * @return The handler execution time
+	 */
+	std::chrono::nanoseconds getElapsed() {
+		return elapsed;
+	}
+
+
+	/**
+	 * \brief Gets how many calls in a row exceeded the budget
+	 *
+	 * @return The number of overruns
+	 */
+	unsigned int getOverruns() {
+		return overruns;
+	}
+
+
+	/**
+	 * \brief Gets whether the handler was moved to the background executor
+	 *
+	 * @return true if the handler no longer runs inside FireEvent
+	 */
+	bool getDemoted() {
+		return demoted;
+	}
+
+private:
+	HandlerRegistration & registration;
+	std::chrono::nanoseconds elapsed;
+	unsigned int overruns;
+	bool demoted;
+
+};
+
+#endif /* _SRC_EVENT_SLOW_HANDLER_EVENT_HPP_ */
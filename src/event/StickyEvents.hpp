@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_STICKY_EVENTS_HPP_
+#define _SRC_EVENT_STICKY_EVENTS_HPP_
+
+#include "Object.hpp"
+#include "Event.hpp"
+
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \brief Cache of the most recent event fired by each sender for a single event type
+ *
+ * The cache owns copies of the events, so they stay valid after the original event object has
+ * gone out of scope.
+ */
+class StickyEvents {
+public:
+	typedef std::vector<std::shared_ptr<Event>> Snapshot;
+
+
+	/**
+	 * \brief Empty virtual destructor
+	 */
+	virtual ~StickyEvents() { }
+
+
+	/**
+	 * \brief Replaces the cached event for the sender of an event
+	 *
+	 * @param e The event to cache, its dynamic type must be the cached event type
+	 */
+	virtual void store(Event & e) = 0;
+
+
+	/**
+	 * \brief Gets the cached event for a sender
+	 *
+	 * @param sender The sender object
+	 * @return The cached event, or nullptr if the sender hasn't fired one
+	 */
+	virtual Event* find(Object & sender) = 0;
+
+
+	/**
+	 * \brief Removes the cached event for a sender
+	 *
+	 * @param sender The sender object
+	 */
+	virtual void erase(Object & sender) = 0;
+
+
+	/**
+	 * \brief Collects copies of the cached events
+	 *
+	 * The copies are handed to handlers when the events are replayed, so a handler that changes
+	 * or cancels its event doesn't change what is cached.
+	 *
+	 * @param sender The sender to collect the event for, or nullptr to collect every cached event
+	 * @param snapshot The collection to append to
+	 */
+	virtual void collect(Object * const sender, Snapshot & snapshot) = 0;
+};
+
+
+/**
+ * \brief Sticky event cache for events of type T
+ */
+template <class T>
+class TypedStickyEvents : public StickyEvents {
+public:
+	TypedStickyEvents() {
+		static_assert(std::is_base_of<Event, T>::value, "TypedStickyEvents<T>: T must be a class derived from Event");
+	}
+
+
+	virtual ~TypedStickyEvents() { }
+
+
+	virtual void store(Event & e) override {
+		// Snapshots may still hold the previous copy, so it is replaced rather than overwritten
+		events[&e.getSender()] = std::make_shared<T>(static_cast<T &>(e));
+	}
+
+
+	virtual Event* find(Object & sender) override {
+		typename Map::iterator it = events.find(&sender);
+		return it != events.end() ? it->second.get() : nullptr;
+	}
+
+
+	virtual void erase(Object & sender) override {
+		events.erase(&sender);
+	}
+
+
+	virtual void collect(Object * const sender, Snapshot & snapshot) override {
+		if (sender != nullptr) {
+			typename Map::iterator it = events.find(sender);
+
+			if (it != events.end()) {
+				snapshot.push_back(std::make_shared<T>(*it->second));
+			}
+
+			return;
+		}
+
+		for (auto & pair : events) {
+			snapshot.push_back(std::make_shared<T>(*pair.second));
+		}
+	}
+
+private:
+	typedef std::unordered_map<Object*, std::shared_ptr<T>> Map;
+
+	Map events;
+};
+
+#endif /* _SRC_EVENT_STICKY_EVENTS_HPP_ */
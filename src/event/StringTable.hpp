@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_STRING_TABLE_HPP_
+#define _SRC_EVENT_STRING_TABLE_HPP_
+
+#include "SharedString.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * \brief Interning table for strings that repeat across many events
+ *
+ * Interning the same characters twice returns strings that share one buffer, so values such as
+ * player and channel names are stored once and compared by pointer. The table is thread safe.
+ */
+class StringTable {
+public:
+	StringTable() { }
+
+
+	/**
+	 * \brief Returns the process-wide string table
+	 *
+	 * @return The string table instance
+	 */
+	static StringTable* const GetInstance() {
+		// Function local so the table is safely created the first time any thread interns a string
+		static StringTable table;
+		return &table;
+	}
+
+
+	/**
+	 * \brief Returns the interned string for a character range
+	 *
+	 * @param data The first character
+	 * @param size The number of characters
+	 * @return The interned string
+	 */
+	SharedString intern(const char * data, std::size_t size) {
+		const std::size_t hash = Hash(data, size);
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto range = strings.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (it->second.size() == size && std::memcmp(it->second.data(), data, size) == 0) {
+				return it->second;
+			}
+		}
+
+		return strings.insert(Map::value_type(hash, SharedString(data, size)))->second;
+	}
+
+
+	/**
+	 * \brief Returns the interned string for a std::string
+	 *
+	 * @param str The string to intern
+	 * @return The interned string
+	 */
+	SharedString intern(const std::string & str) {
+		return intern(str.data(), str.size());
+	}
+
+
+	/**
+	 * \brief Returns the interned string for a SharedString
+	 *
+	 * @param str The string to intern
+	 * @return The interned string
+	 */
+	SharedString intern(const SharedString & str) {
+		return intern(str.data(), str.size());
+	}
+
+
+	/**
+	 * \brief Frees the interned strings that are no longer used outside of the table
+	 *
+	 * @return The number of strings removed
+	 */
+	std::size_t purge() {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::size_t removed = 0;
+
+		for (Map::iterator it = strings.begin(); it != strings.end(); ) {
+			if (it->second.useCount() == 1) {
+				it = strings.erase(it);
+				++removed;
+			} else {
+				++it;
+			}
+		}
+
+		return removed;
+	}
+
+private:
+	typedef std::unordered_multimap<std::size_t, SharedString> Map;
+
+	std::mutex mutex;
+	Map strings;
+
+	StringTable(const StringTable &) = delete;
+	StringTable & operator=(const StringTable &) = delete;
+
+
+	/**
+	 * \brief FNV-1a hash of a character range
+	 */
+	static std::size_t Hash(const char * data, std::size_t size) {
+		std::size_t hash = static_cast<std::size_t>(14695981039346656037ull);
+
+		for (std::size_t i = 0; i < size; ++i) {
+			hash ^= static_cast<unsigned char>(data[i]);
+			hash *= static_cast<std::size_t>(1099511628211ull);
+		}
+
+		return hash;
+	}
+};
+
+#endif /* _SRC_EVENT_STRING_TABLE_HPP_ */
@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_WINDOWED_AGGREGATOR_HPP_
+#define _SRC_EVENT_WINDOWED_AGGREGATOR_HPP_
+
+#include "Object.hpp"
+#include "EventHandler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief Count, sum, minimum and maximum of the values seen for one key
+ */
+struct Aggregate {
+	Aggregate() :
+		count(0),
+		sum(0),
+		min(std::numeric_limits<long long>::max()),
+		max(std::numeric_limits<long long>::min())
+	{ }
+
+	void add(long long value) {
+		++count;
+		sum += value;
+		min = std::min(min, value);
+		max = std::max(max, value);
+	}
+
+	void merge(const Aggregate & other) {
+		count += other.count;
+		sum += other.sum;
+		min = std::min(min, other.min);
+		max = std::max(max, other.max);
+	}
+
+	unsigned long long count;
+	long long sum;
+	long long min;
+	long long max;
+};
+
+
+/**
+ * \brief Aggregates of every key for one closed window
+ */
+template <class Key>
+struct WindowResult {
+	/**
+	 * \brief The aggregate field used to rank keys
+	 */
+	enum Metric {
+		Count,
+		Sum,
+		Min,
+		Max
+	};
+
+	typedef std::unordered_map<Key, Aggregate> Groups;
+
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::time_point end;
+	Groups groups;
+
+
+	/**
+	 * \brief Gets the keys with the largest aggregates
+	 *
+	 * @param k The number of keys to return
+	 * @param metric The aggregate field to rank by
+	 * @return Up to k keys and their aggregates, largest first
+	 */
+	std::vector<std::pair<Key, Aggregate>> top(std::size_t k, Metric metric = Count) const {
+		std::vector<std::pair<Key, Aggregate>> ranked(groups.begin(), groups.end());
+		k = std::min(k, ranked.size());
+
+		std::partial_sort(ranked.begin(), ranked.begin() + k, ranked.end(),
+			[metric](const std::pair<Key, Aggregate> & a, const std::pair<Key, Aggregate> & b) {
+				return Value(a.second, metric) > Value(b.second, metric);
+			});
+
+		ranked.resize(k);
+		return ranked;
+	}
+
+private:
+	static long long Value(const Aggregate & aggregate, Metric metric) {
+		switch (metric) {
+		case Sum:
+			return aggregate.sum;
+		case Min:
+			return aggregate.min;
+		case Max:
+			return aggregate.max;
+		default:
+			return static_cast<long long>(aggregate.count);
+		}
+	}
+};
+
+
+/**
+ * \brief Event handler that aggregates events over tumbling or sliding time windows
+ *
+ * Every event is reduced to a key (the sender by default) and a value (1 by default) which are
+ * folded into a count, sum, minimum and maximum per key. Each firing thread folds into its own
+ * partial aggregates without taking a lock, so threads don't contend on a shared map. When a pane
+ * of the window ends, the partials are merged and the listener receives the aggregates of the
+ * whole window.
+ *
+ * A tumbling window uses a slide equal to the window length. A sliding window uses a shorter
+ * slide, and the window length should be a multiple of it. Windows are closed by the first event
+ * after they end, or by advance() when events stop arriving. Windows without any events aren't
+ * reported.
+ *
+ * \code
+ * // Chat messages per player per minute, reported every 10 seconds
+ * WindowedAggregator<PlayerChatEvent> chatRate(std::chrono::minutes(1), std::chrono::seconds(10),
+ *     [](WindowResult<Object*> & window) { ... });
+ * EventBus::AddHandler<PlayerChatEvent>(chatRate);
+ * \endcode
+ */
+template <class T, class Key = Object*>
+class WindowedAggregator : public EventHandler<T>
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+	typedef Key (*KeyOf)(T &);
+	typedef long long (*ValueOf)(T &);
+	typedef std::function<void(WindowResult<Key> &)> Listener;
+
+
+	/**
+	 * \brief Creates an aggregator
+	 *
+	 * @param window The length of a window
+	 * @param slide How often a window is reported, equal to the window length for tumbling windows
+	 * @param listener Receives the aggregates of each window
+	 * @param keyOf Extracts the grouping key from an event, nullptr groups by sender
+	 * @param valueOf Extracts the aggregated value from an event, nullptr uses 1
+	 */
+	WindowedAggregator(Clock::duration window, Clock::duration slide, Listener listener, KeyOf keyOf = nullptr, ValueOf valueOf = nullptr) :
+		slide(slide > Clock::duration::zero() ? slide : window),
+		panesPerWindow(std::max<std::size_t>(1, static_cast<std::size_t>(window / this->slide))),
+		listener(listener),
+		keyOf(keyOf != nullptr ? keyOf : &SenderKey),
+		valueOf(valueOf),
+		id(NextId()),
+		buffer(0) {
+		paneStart = Clock::now();
+		paneEnd.store((paneStart + this->slide).time_since_epoch().count(), std::memory_order_relaxed);
+	}
+
+
+	/**
+	 * \brief Retires the partial aggregates of every thread
+	 *
+	 * The threads still hold on to their partials, so they are emptied here and dropped from the
+	 * threads' caches the next time those look one up.
+	 */
+	virtual ~WindowedAggregator() {
+		for (auto & partial : partials) {
+			partial->retired.store(true, std::memory_order_release);
+
+			for (int i = 0; i < 2; ++i) {
+				partial->groups[i].clear();
+				partial->last[i] = nullptr;
+			}
+		}
+	}
+
+
+	/**
+	 * \brief Folds an event into the calling thread's partial aggregates
+	 *
+	 * @param e The fired event
+	 */
+	virtual void onEvent(T & e) override {
+		const Clock::time_point now = Clock::now();
+
+		if (now.time_since_epoch().count() >= paneEnd.load(std::memory_order_acquire)) {
+			close(now);
+		}
+
+		const Key key = keyOf(e);
+		const long long value = valueOf != nullptr ? valueOf(e) : 1;
+
+		Partial & partial = threadPartial();
+
+		// The flag is set before the buffer is read, so close() either sees this thread folding or
+		// this thread sees the buffer close() switched to
+		partial.folding.store(true);
+
+		const unsigned int current = buffer.load() & 1;
+		typename Groups::value_type* & last = partial.last[current];
+
+		// Events tend to repeat the key of the previous one, which skips hashing it again
+		if (last == nullptr || !(last->first == key)) {
+			last = &*partial.groups[current].insert(std::make_pair(key, Aggregate())).first;
+		}
+
+		last->second.add(value);
+		partial.folding.store(false, std::memory_order_release);
+	}
+
+
+	/**
+	 * \brief Closes any panes that have ended, reporting their windows
+	 *
+	 * Call this periodically if events can stop arriving, otherwise the last window is only
+	 * reported when the next event is fired.
+	 */
+	void advance() {
+		const Clock::time_point now = Clock::now();
+
+		if (now.time_since_epoch().count() >= paneEnd.load(std::memory_order_acquire)) {
+			close(now);
+		}
+	}
+
+private:
+	typedef typename WindowResult<Key>::Groups Groups;
+
+	/**
+	 * \brief Partial aggregates of the current pane for one thread
+	 *
+	 * The thread folds into one of the two buffers while close() takes the other one, and last
+	 * points at the group of the key the thread folded into most recently.
+	 */
+	struct Partial {
+		Partial() :
+			folding(false),
+			retired(false)
+		{
+			last[0] = nullptr;
+			last[1] = nullptr;
+		}
+
+		std::atomic<bool> folding;
+		std::atomic<bool> retired;
+		Groups groups[2];
+		typename Groups::value_type* last[2];
+	};
+
+	typedef std::pair<unsigned long long, std::shared_ptr<Partial>> CacheEntry;
+
+	const Clock::duration slide;
+	const std::size_t panesPerWindow;
+	const Listener listener;
+	const KeyOf keyOf;
+	const ValueOf valueOf;
+	const unsigned long long id;
+
+	// The partial buffer events are folded into, flipped each time a pane is closed
+	std::atomic<unsigned int> buffer;
+
+	// Guards the list of partials and the closed panes
+	std::mutex mutex;
+	std::vector<std::shared_ptr<Partial>> partials;
+	std::deque<Groups> panes;
+	Clock::time_point paneStart;
+	std::atomic<Clock::rep> paneEnd;
+
+
+	static Object* SenderKey(T & e) {
+		return &e.getSender();
+	}
+
+
+	static unsigned long long NextId() {
+		static std::atomic<unsigned long long> next(0);
+		return ++next;
+	}
+
+
+	/**
+	 * \brief Finds the calling thread's partial aggregates, creating them on first use
+	 *
+	 * Threads remember their partial for each aggregator by id, so the aggregator's mutex is only
+	 * taken the first time a thread fires to it. The partial used last is checked before the rest
+	 * of the cache, and partials of destroyed aggregators are evicted while the cache is searched.
+	 */
+	Partial & threadPartial() {
+		static thread_local CacheEntry recent;
+		static thread_local std::vector<CacheEntry> cache;
+
+		if (recent.first == id) {
+			return *recent.second;
+		}
+
+		for (std::size_t i = 0; i < cache.size(); ) {
+			if (cache[i].second->retired.load(std::memory_order_acquire)) {
+				cache[i] = std::move(cache.back());
+				cache.pop_back();
+			} else if (cache[i].first == id) {
+				recent = cache[i];
+				return *recent.second;
+			} else {
+				++i;
+			}
+		}
+
+		std::shared_ptr<Partial> partial = std::make_shared<Partial>();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			partials.push_back(partial);
+		}
+
+		cache.push_back(std::make_pair(id, partial));
+		recent = cache.back();
+		return *partial;
+	}
+
+
+	/**
+	 * \brief Merges the partials into the pane that ended and reports the window
+	 *
+	 * @param now The current time
+	 */
+	void close(Clock::time_point now) {
+		std::vector<WindowResult<Key>> windows;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			// Another thread may have closed the pane while this one waited for the lock
+			if (now.time_since_epoch().count() < paneEnd.load(std::memory_order_relaxed)) {
+				return;
+			}
+
+			Groups pane;
+
+			// New events go to the other buffer, so once a partial's thread is done folding into
+			// the closed one it can be taken without a lock
+			const unsigned int closed = buffer.fetch_add(1) & 1;
+
+			for (auto & partial : partials) {
+				Groups groups;
+
+				while (partial->folding.load(std::memory_order_acquire)) {
+					std::this_thread::yield();
+				}
+
+				groups.swap(partial->groups[closed]);
+				partial->last[closed] = nullptr;
+
+				for (auto & group : groups) {
+					pane[group.first].merge(group.second);
+				}
+			}
+
+			// Every pane that ended after the first one had no events
+			const std::size_t elapsed = static_cast<std::size_t>((now - paneStart) / slide);
+
+			for (std::size_t i = 0; i < elapsed; ++i) {
+				panes.push_back(i == 0 ? std::move(pane) : Groups());
+				paneStart += slide;
+
+				if (panes.size() > panesPerWindow) {
+					panes.pop_front();
+				}
+
+				// Once the whole window is empty, skip ahead without reporting the rest
+				if (i >= panesPerWindow && i + 1 < elapsed) {
+					paneStart += slide * static_cast<Clock::rep>(elapsed - i - 1);
+					panes.clear();
+					break;
+				}
+
+				WindowResult<Key> window;
+				window.end = paneStart;
+				window.start = paneStart - slide * static_cast<Clock::rep>(panes.size());
+
+				for (auto & closed : panes) {
+					for (auto & group : closed) {
+						window.groups[group.first].merge(group.second);
+					}
+				}
+
+				if (!window.groups.empty()) {
+					windows.push_back(std::move(window));
+				}
+			}
+
+			paneEnd.store((paneStart + slide).time_since_epoch().count(), std::memory_order_release);
+		}
+
+		// Report outside of the lock so the listener can take its time
+		for (auto & window : windows) {
+			listener(window);
+		}
+	}
+};
+
+#endif /* _SRC_EVENT_WINDOWED_AGGREGATOR_HPP_ */
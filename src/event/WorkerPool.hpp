@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2014, Dan Quist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SRC_EVENT_WORKER_POOL_HPP_
+#define _SRC_EVENT_WORKER_POOL_HPP_
+
+#include "Executor.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Executor that runs tasks on a fixed set of worker threads
+ *
+ * Tasks are run in the order they were posted, but tasks posted back to back may run at the same
+ * time on different workers.
+ *
+ * \code
+ * WorkerPool workers(std::thread::hardware_concurrency());
+ * EventBus::SetWorkers(&workers, workers.size());
+ * \endcode
+ */
+class WorkerPool : public Executor {
+public:
+	/**
+	 * \brief Starts the worker threads
+	 *
+	 * @param threads The number of worker threads
+	 */
+	WorkerPool(std::size_t threads) :
+		head(nullptr),
+		tail(nullptr),
+		stopping(false) {
+		if (threads == 0) {
+			threads = 1;
+		}
+
+		for (std::size_t i = 0; i < threads; ++i) {
+			workers.push_back(std::thread(&WorkerPool::work, this));
+		}
+	}
+
+
+	/**
+	 * \brief Waits for the running tasks to finish and discards the tasks that haven't started
+	 */
+	virtual ~WorkerPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+			wakeup.notify_all();
+		}
+
+		for (auto & worker : workers) {
+			worker.join();
+		}
+
+		while (head != nullptr) {
+			Task* task = head;
+			head = task->next;
+			task->handler(task, false);
+		}
+	}
+
+
+	/**
+	 * \brief Schedules a function to be run on a worker thread
+	 *
+	 * @param function The function to call
+	 * @param argument The argument passed to the function
+	 */
+	virtual void post(Function function, void * argument) override {
+		post(*new FunctionTask(function, argument));
+	}
+
+
+	/**
+	 * \brief Schedules a task to be run on a worker thread, without allocating
+	 *
+	 * @param task The task to run
+	 */
+	virtual void post(Task & task) override {
+		task.next = nullptr;
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (tail != nullptr) {
+			tail->next = &task;
+		} else {
+			head = &task;
+		}
+
+		tail = &task;
+		wakeup.notify_one();
+	}
+
+
+	/**
+	 * \brief Gets the number of worker threads
+	 *
+	 * @return The number of worker threads
+	 */
+	std::size_t size() const {
+		return workers.size();
+	}
+
+private:
+	/**
+	 * \brief Worker thread loop
+	 */
+	void work() {
+		std::unique_lock<std::mutex> lock(mutex);
+
+		for (;;) {
+			wakeup.wait(lock, [this] { return head != nullptr || stopping; });
+
+			if (stopping) {
+				return;
+			}
+
+			Task* task = head;
+			head = task->next;
+
+			if (head == nullptr) {
+				tail = nullptr;
+			}
+
+			lock.unlock();
+			task->handler(task, true);
+			lock.lock();
+		}
+	}
+
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	Task* head;
+	Task* tail;
+	bool stopping;
+
+	WorkerPool(const WorkerPool &) = delete;
+	WorkerPool & operator=(const WorkerPool &) = delete;
+};
+
+#endif /* _SRC_EVENT_WORKER_POOL_HPP_ */